@@ -0,0 +1,116 @@
+#include <cstdio>
+#include <ctime>
+#include <thread>
+#include <vector>
+
+#include "params.h"
+
+using namespace std;
+
+#include "../HyperCalm/ConcurrentHyperBloomFilter.h"
+#include "../ComparedAlgorithms/groundtruth.h"
+
+using namespace groundtruth::type_info;
+
+// Items are dealt to the threads in small blocks round-robin, so that every
+// thread sees the whole key space in roughly time order, like producers that
+// are not partitioned by key.
+template <typename Sketch>
+vector<Index> concurrent_insert_result(
+    Sketch& sketch,
+    const vector<Record>& input,
+    int threads
+) {
+    constexpr int BlockSize = 64;
+    vector<char> is_new(input.size());
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.emplace_back([&, t] {
+            for (int start = t * BlockSize; start < input.size(); start += threads * BlockSize) {
+                int end = min(start + BlockSize, int(input.size()));
+                for (int i = start; i < end; ++i) {
+                    auto& [key, time] = input[i];
+                    is_new[i] = sketch.insert(key, time);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers)
+        worker.join();
+    vector<Index> res;
+    for (int i = 0; i < input.size(); ++i) {
+        if (is_new[i]) {
+            res.push_back(i);
+        }
+    }
+    return res;
+}
+
+tuple<int, int> single_hit_test(
+    const vector<Index>& results,
+    const vector<Index>& objects,
+    const vector<Index>& batches
+) {
+    int object_count = 0, correct_count = 0;
+    int j = 0, k = 0;
+    for (int i : results) {
+        while (j + 1 < int(batches.size()) && batches[j] < i)
+            ++j;
+        if (j < int(batches.size()) && batches[j] == i) {
+            ++correct_count;
+        }
+        while (k + 1 < int(objects.size()) && objects[k] < i)
+            ++k;
+        if (k < int(objects.size()) && objects[k] == i) {
+            ++object_count;
+        }
+    }
+    return make_tuple(object_count, correct_count);
+}
+
+void concurrent_test(const vector<Record>& input) {
+    groundtruth::adjust_params(input, BATCH_TIME, UNIT_TIME);
+    groundtruth::item_count(input);
+    auto [objects, batches] = groundtruth::batch(input, BATCH_TIME, BATCH_SIZE_LIMIT);
+    int max_threads = thread_num ? thread_num : max(1u, thread::hardware_concurrency());
+    printf("---------------------------------------------\n");
+    printf("Test concurrent Hyper Bloom filter, 1 to %d threads\n", max_threads);
+    vector<int> thread_counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+        thread_counts.push_back(threads);
+    thread_counts.push_back(max_threads);
+    for (int threads : thread_counts) {
+        printf("---------------------------------------------\n");
+        uint64_t time_ns = 0;
+        int object_count = 0, correct_count = 0, tot_our_size = 0;
+        for (int t = 0; t < repeat_time; ++t) {
+            ConcurrentHyperBloomFilter<> sketch(memory, BATCH_TIME, t);
+            timespec start_time, end_time;
+            clock_gettime(CLOCK_MONOTONIC, &start_time);
+            auto res = concurrent_insert_result(sketch, input, threads);
+            clock_gettime(CLOCK_MONOTONIC, &end_time);
+            time_ns += (end_time.tv_sec - start_time.tv_sec) * uint64_t(1e9);
+            time_ns += (end_time.tv_nsec - start_time.tv_nsec);
+            auto [objs, corrects] = single_hit_test(res, objects, batches);
+            object_count += objs;
+            correct_count += corrects;
+            tot_our_size += res.size();
+        }
+        printf("Threads:\t %d\n", threads);
+        printf("Average Speed:\t %f M/s\n", 1e3 * input.size() * repeat_time / time_ns);
+        printf("Recall Rate:\t %f\n", 1.0 * object_count / objects.size() / repeat_time);
+        printf("Precision Rate:\t %f\n", 1.0 * correct_count / tot_our_size);
+    }
+}
+
+extern void ParseArgs(int argc, char** argv);
+extern vector<Record> load_data(const string& fileName);
+
+int main(int argc, char** argv) {
+    ParseArgs(argc, argv);
+    printf("---------------------------------------------\n");
+    auto input = load_data(fileName);
+    printf("---------------------------------------------\n");
+    concurrent_test(input);
+    printf("---------------------------------------------\n");
+}
@@ -11,11 +11,12 @@ using namespace std;
 #include "../ComparedAlgorithms/SWAMP.h"
 #include "../ComparedAlgorithms/TOBF.h"
 #include "../ComparedAlgorithms/groundtruth.h"
+#include "../datasets/trace_stream.h"
 
 using namespace groundtruth::type_info;
 
-template <typename Sketch>
-vector<Index> insert_result(Sketch&& sketch, const vector<Record>& input) {
+template <typename Sketch, typename Time>
+vector<Index> insert_result(Sketch&& sketch, const vector<pair<uint32_t, Time>>& input) {
     vector<int> res;
     for (int i = 0; i < input.size(); ++i) {
         auto& [key, time] = input[i];
@@ -26,6 +27,50 @@ vector<Index> insert_result(Sketch&& sketch, const vector<Record>& input) {
 	return res;
 }
 
+// Feed the sketch through its batched API, one chunk of records at a time.
+template <typename Sketch>
+vector<Index> insert_batch_result(Sketch&& sketch, const vector<Record>& input) {
+    constexpr int ChunkSize = 4096;
+    uint32_t keys[ChunkSize];
+    float times[ChunkSize];
+    bool is_new[ChunkSize];
+    vector<int> res;
+    for (int start = 0; start < input.size(); start += ChunkSize) {
+        int len = min(ChunkSize, int(input.size()) - start);
+        for (int i = 0; i < len; ++i)
+            tie(keys[i], times[i]) = input[start + i];
+        sketch.insert(keys, times, len, is_new);
+        for (int i = 0; i < len; ++i) {
+            if (is_new[i]) {
+                res.push_back(start + i);
+            }
+        }
+    }
+    return res;
+}
+
+// Timestamps in integer nanoseconds, for HyperBF with a TickThreshold.
+constexpr double TicksPerSecond = 1e9;
+
+template <typename Sketch>
+vector<Index> insert_ticks_result(Sketch&& sketch, const vector<pair<uint32_t, uint64_t>>& input) {
+    vector<int> res;
+    for (int i = 0; i < input.size(); ++i) {
+        auto& [key, tick] = input[i];
+        if (sketch.insert_ticks(key, tick)) {
+            res.push_back(i);
+        }
+    }
+    return res;
+}
+
+vector<pair<uint32_t, uint64_t>> to_ticks(const vector<Record>& input) {
+    vector<pair<uint32_t, uint64_t>> res(input.size());
+    for (int i = 0; i < input.size(); ++i)
+        res[i] = { input[i].first, llround(input[i].second * TicksPerSecond) };
+    return res;
+}
+
 tuple<int, int> single_hit_test(
     const vector<Index>& results,
     const vector<Index>& objects,
@@ -49,12 +94,17 @@ tuple<int, int> single_hit_test(
 }
 
 void hit_test(const vector<Record>& input) {
+    HyperBF::max_simd_level = HyperBF::SimdLevel(simd_level);
     constexpr bool use_counter = false;
     groundtruth::adjust_params(input, BATCH_TIME, UNIT_TIME);
     groundtruth::item_count(input);
     auto [objects, batches] = groundtruth::batch(input, BATCH_TIME, BATCH_SIZE_LIMIT);
     printf("---------------------------------------------\n");
     printName(sketchName);
+    vector<pair<uint32_t, uint64_t>> tick_input;
+    HyperBF::TickThreshold tick_threshold { uint64_t(llround(BATCH_TIME * TicksPerSecond)) };
+    if (sketchName == 6)
+        tick_input = to_ticks(input);
     uint64_t time_ns = 0;
     int object_count = 0, correct_count = 0, tot_our_size = 0;
     for (int t = 0; t < repeat_time; ++t) {
@@ -69,6 +119,10 @@ void hit_test(const vector<Record>& input) {
             res = insert_result(TOBF<use_counter>(memory, BATCH_TIME, 4, t), input);
         else if (sketchName == 4)
             res = insert_result(SWAMP<int, float, use_counter>(memory, BATCH_TIME), input);
+        else if (sketchName == 5)
+            res = insert_batch_result(HyperBloomFilter(memory, BATCH_TIME, t), input);
+        else if (sketchName == 6)
+            res = insert_ticks_result(HyperBloomFilter(memory, tick_threshold, t), tick_input);
         clock_gettime(CLOCK_MONOTONIC, &end_time);
         time_ns += (end_time.tv_sec - start_time.tv_sec) * uint64_t(1e9);
         time_ns += (end_time.tv_nsec - start_time.tv_nsec);
@@ -92,3 +146,82 @@ void hit_test(const vector<Record>& input) {
                 correct_count, tot_our_size - correct_count, int(objects.size()) - object_count);
     }
 }
+
+template <typename Sketch>
+tuple<size_t, int> stream_insert_result(Sketch&& sketch) {
+    TraceStream trace(fileName);
+    int reported = 0;
+    size_t n = trace.for_each([&](uint32_t key, float time) { reported += sketch.insert(key, time); });
+    return { n, reported };
+}
+
+template <typename Sketch>
+tuple<size_t, int> stream_insert_batch_result(Sketch&& sketch) {
+    constexpr int ChunkSize = 4096;
+    uint32_t keys[ChunkSize];
+    float times[ChunkSize];
+    bool is_new[ChunkSize];
+    TraceStream trace(fileName);
+    size_t total = 0;
+    int reported = 0;
+    for (auto [records, n] = trace.next(); n; tie(records, n) = trace.next()) {
+        for (size_t start = 0; start < n; start += ChunkSize) {
+            int len = min(size_t(ChunkSize), n - start);
+            for (int i = 0; i < len; ++i)
+                tie(keys[i], times[i]) = records[start + i];
+            sketch.insert(keys, times, len, is_new);
+            reported += count(is_new, is_new + len, true);
+        }
+        total += n;
+    }
+    return { total, reported };
+}
+
+// Stream the trace through the sketch in chunks read by another thread, so
+// traces of any length run in constant memory. There is no ground truth, so
+// only the speed and the number of reported batches are printed.
+void stream_hit_test() {
+    if (!BATCH_TIME) {
+        printf("please use -b to give BATCH_TIME when streaming.\n");
+        exit(0);
+    }
+    HyperBF::max_simd_level = HyperBF::SimdLevel(simd_level);
+    constexpr bool use_counter = false;
+    printf("Streaming %s\n", fileName.c_str());
+    printf("BATCH_TIME = %f\n", BATCH_TIME);
+    printf("---------------------------------------------\n");
+    printName(sketchName);
+    uint64_t time_ns = 0;
+    size_t items = 0;
+    int reported = 0;
+    for (int t = 0; t < repeat_time; ++t) {
+        timespec start_time, end_time;
+        clock_gettime(CLOCK_MONOTONIC, &start_time);
+        tuple<size_t, int> res;
+        if (sketchName == 1)
+            res = stream_insert_result(HyperBloomFilter(memory, BATCH_TIME, t));
+        else if (sketchName == 2)
+            res = stream_insert_result(ClockSketch<use_counter>(memory, BATCH_TIME, t));
+        else if (sketchName == 3)
+            res = stream_insert_result(TOBF<use_counter>(memory, BATCH_TIME, 4, t));
+        else if (sketchName == 4)
+            res = stream_insert_result(SWAMP<int, float, use_counter>(memory, BATCH_TIME));
+        else if (sketchName == 5)
+            res = stream_insert_batch_result(HyperBloomFilter(memory, BATCH_TIME, t));
+        else {
+            printf("streaming supports algorithms 1 to 5.\n");
+            exit(0);
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end_time);
+        time_ns += (end_time.tv_sec - start_time.tv_sec) * uint64_t(1e9);
+        time_ns += (end_time.tv_nsec - start_time.tv_nsec);
+        items += get<0>(res);
+        reported += get<1>(res);
+    }
+    printf("---------------------------------------------\n");
+    printf("Results:\n");
+    printf("Algorithm time:\t %f s\n", time_ns / 1e9);
+    printf("Average Speed:\t %f M/s\n", 1e3 * items / time_ns);
+    printf("Items:\t\t %zu\n", items / repeat_time);
+    printf("Reported:\t %d\n", reported / repeat_time);
+}
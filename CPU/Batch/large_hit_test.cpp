@@ -44,6 +44,7 @@ tuple<int, int> single_test(
 }
 
 void large_hit_test(const vector<Record>& input) {
+    HyperBF::max_simd_level = HyperBF::SimdLevel(simd_level);
     timespec start_time, end_time;
     uint64_t time_ns;
     groundtruth::adjust_params(input, BATCH_TIME, UNIT_TIME);
@@ -8,10 +8,16 @@ extern void ParseArgs(int argc, char** argv);
 extern vector<pair<uint32_t, float>> load_data(const string& fileName);
 
 extern void hit_test(const vector<pair<uint32_t, float>>& input);
+extern void stream_hit_test();
 
 int main(int argc, char** argv) {
 	ParseArgs(argc, argv);
 	printf("---------------------------------------------\n");
+	if (stream) {
+		stream_hit_test();
+		printf("---------------------------------------------\n");
+		return 0;
+	}
 	auto input = load_data(fileName);
 	printf("---------------------------------------------\n");
 	hit_test(input);
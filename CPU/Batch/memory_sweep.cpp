@@ -0,0 +1,113 @@
+#include <cstdio>
+#include <ctime>
+
+#include "params.h"
+
+using namespace std;
+
+#include "../HyperCalm/HyperBloomFilter.h"
+#include "../ComparedAlgorithms/ClockSketch.h"
+#include "../ComparedAlgorithms/TOBF.h"
+#include "../ComparedAlgorithms/groundtruth.h"
+
+using namespace groundtruth::type_info;
+
+template <typename Sketch>
+vector<Index> insert_result(Sketch&& sketch, const vector<Record>& input) {
+    vector<Index> res;
+    for (int i = 0; i < input.size(); ++i) {
+        auto& [key, time] = input[i];
+        if (sketch.insert(key, time)) {
+            res.push_back(i);
+        }
+    }
+    return res;
+}
+
+tuple<int, int> single_hit_test(
+    const vector<Index>& results,
+    const vector<Index>& objects,
+    const vector<Index>& batches
+) {
+    int object_count = 0, correct_count = 0;
+    int j = 0, k = 0;
+    for (int i : results) {
+        while (j + 1 < int(batches.size()) && batches[j] < i)
+            ++j;
+        if (j < int(batches.size()) && batches[j] == i) {
+            ++correct_count;
+        }
+        while (k + 1 < int(objects.size()) && objects[k] < i)
+            ++k;
+        if (k < int(objects.size()) && objects[k] == i) {
+            ++object_count;
+        }
+    }
+    return make_tuple(object_count, correct_count);
+}
+
+// Runs the sketch with memory doubled from -m up to -M, to check that the
+// accuracy keeps improving as long as there are more keys than cells.
+void memory_sweep(const vector<Record>& input) {
+    HyperBF::max_simd_level = HyperBF::SimdLevel(simd_level);
+    constexpr bool use_counter = false;
+    groundtruth::adjust_params(input, BATCH_TIME, UNIT_TIME);
+    groundtruth::item_count(input);
+    auto [objects, batches] = groundtruth::batch(input, BATCH_TIME, BATCH_SIZE_LIMIT);
+    printf("---------------------------------------------\n");
+    printName(sketchName);
+    vector<int> memories = { memory };
+    while (int64_t(memories.back()) * 2 <= max_memory)
+        memories.push_back(memories.back() * 2);
+    printf("Memory sweep from %d B to %d B\n", memories.front(), memories.back());
+    vector<tuple<int, double, double, double>> rows;
+    for (int mem : memories) {
+        printf("---------------------------------------------\n");
+        uint64_t time_ns = 0;
+        int object_count = 0, correct_count = 0, tot_our_size = 0;
+        for (int t = 0; t < repeat_time; ++t) {
+            timespec start_time, end_time;
+            clock_gettime(CLOCK_MONOTONIC, &start_time);
+            vector<Index> res;
+            if (sketchName == 1)
+                res = insert_result(HyperBloomFilter(mem, BATCH_TIME, t), input);
+            else if (sketchName == 2)
+                res = insert_result(ClockSketch<use_counter>(mem, BATCH_TIME, t), input);
+            else if (sketchName == 3)
+                res = insert_result(TOBF<use_counter>(mem, BATCH_TIME, 4, t), input);
+            clock_gettime(CLOCK_MONOTONIC, &end_time);
+            time_ns += (end_time.tv_sec - start_time.tv_sec) * uint64_t(1e9);
+            time_ns += (end_time.tv_nsec - start_time.tv_nsec);
+            auto [objs, corrects] = single_hit_test(res, objects, batches);
+            object_count += objs;
+            correct_count += corrects;
+            tot_our_size += res.size();
+        }
+        double recall = 1.0 * object_count / objects.size() / repeat_time;
+        double precision = tot_our_size ? 1.0 * correct_count / tot_our_size : 0.;
+        rows.emplace_back(mem, recall, precision, 1e3 * input.size() * repeat_time / time_ns);
+    }
+    printf("---------------------------------------------\n");
+    printf("Results:\n");
+    printf("Memory (B)\t Recall\t\t Precision\t F1\t\t Speed (M/s)\n");
+    for (auto [mem, recall, precision, speed] : rows) {
+        auto f1 = recall || precision ? 2 * recall * precision / (recall + precision) : 0.;
+        printf("%d\t %f\t %f\t %f\t %f\n", mem, recall, precision, f1, speed);
+    }
+}
+
+extern void ParseArgs(int argc, char** argv);
+extern vector<Record> load_data(const string& fileName);
+
+int main(int argc, char** argv) {
+    ParseArgs(argc, argv);
+    if (sketchName > 3) {
+        printf("memory_sweep supports -s 1 to 3\n");
+        return 0;
+    }
+    printf("---------------------------------------------\n");
+    auto input = load_data(fileName);
+    printf("---------------------------------------------\n");
+    memory_sweep(input);
+    printf("---------------------------------------------\n");
+}
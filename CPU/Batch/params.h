@@ -8,6 +8,10 @@ inline int sketchName;
 inline double BATCH_TIME, UNIT_TIME;
 inline bool verbose = false;
 inline int repeat_time = 1, BATCH_SIZE_LIMIT = 1, memory = 1e4;
+inline int simd_level = 2; // widest HyperBF kernel: 0 scalar, 1 AVX2, 2 AVX-512
+inline int thread_num = 0; // max threads of concurrent_test, 0 for all cores
+inline int max_memory = 0; // largest memory of memory_sweep, doubled from memory
+inline bool stream = false; // stream the trace in chunks instead of loading it
 
 static void printName(int sketchName) {
     if (sketchName == 1) {
@@ -18,6 +22,10 @@ static void printName(int sketchName) {
         printf("Test Time-Out Bloom filter\n");
     } else if (sketchName == 4) {
         printf("Test SWAMP\n");
+    } else if (sketchName == 5) {
+        printf("Test Hyper Bloom filter (batched)\n");
+    } else if (sketchName == 6) {
+        printf("Test Hyper Bloom filter (integer ticks)\n");
     };
 }
 
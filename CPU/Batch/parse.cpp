@@ -21,6 +21,10 @@ void ParseArgs(int argc, char** argv) {
         ("memory,m", value<int>()->required(), "memory")
         ("batch_time,b", value<double>()->required(), "batch time")
         ("unit_time,u", value<double>()->required(),"unit time")
+        ("simd,S", value<int>(), "widest SIMD kernel of HyperBF (0-2)")
+        ("threads,T", value<int>(), "max number of threads")
+        ("max_memory,M", value<int>(), "max memory of the memory sweep")
+        ("stream,R", "stream the trace in chunks, without the ground truth")
         ("verbose,V", "show verbose output");
     variables_map vm;
 
@@ -33,8 +37,8 @@ void ParseArgs(int argc, char** argv) {
     }
     if (vm.count("sketchName")) {
         sketchName = vm["sketchName"].as<int>();
-        if (sketchName < 1 || sketchName > 4) {
-            printf("sketchName < 1 || sketchName > 4\n");
+        if (sketchName < 1 || sketchName > 6) {
+            printf("sketchName < 1 || sketchName > 6\n");
             exit(0);
         }
     } else {
@@ -51,6 +55,19 @@ void ParseArgs(int argc, char** argv) {
         BATCH_TIME = vm["batch_time"].as<double>();
     if (vm.count("unit_time"))
         UNIT_TIME = vm["unit_time"].as<double>();
+    if (vm.count("simd")) {
+        simd_level = vm["simd"].as<int>();
+        if (simd_level < 0 || simd_level > 2) {
+            printf("simd < 0 || simd > 2\n");
+            exit(0);
+        }
+    }
+    if (vm.count("threads"))
+        thread_num = vm["threads"].as<int>();
+    if (vm.count("max_memory"))
+        max_memory = vm["max_memory"].as<int>();
+    if (vm.count("stream"))
+        stream = true;
     if (vm.count("verbose"))
         verbose = true;
 }
@@ -93,6 +93,7 @@ extern vector<Record> load_data(const string& fileName);
 
 int main(int argc, char** argv) {
     ParseArgs(argc, argv);
+    HyperBF::max_simd_level = HyperBF::SimdLevel(simd_level);
     printf("---------------------------------------------\n");
     auto input = load_data(fileName);
     printf("---------------------------------------------\n");
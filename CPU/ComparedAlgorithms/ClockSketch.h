@@ -3,6 +3,9 @@
 
 #include <cstring>
 #include <random>
+#include <stdexcept>
+
+#include "../lib/FastRange.h"
 
 template <bool use_counter = false>
 class ClockSketch {
@@ -15,7 +18,7 @@ public:
     double time_threshold;
     int64_t la_time;
     uint32_t bucket_num, la_pos;
-    uint32_t seeds[TableNum + 1];
+    uint64_t seeds[TableNum + 1];
 
 protected:
     static constexpr size_t CellBits = 4;
@@ -42,9 +45,9 @@ public:
         if constexpr (use_counter) {
             counters = new uint64_t[bucket_num] {};
         }
-        std::mt19937 rng(seed);
+        std::mt19937_64 rng(seed);
         for (int i = 0; i <= TableNum; ++i) {
-            seeds[i] = rng();
+            seeds[i] = randomOddSeed(rng);
         }
         printf("%d\t (Number of arrays in Clock-Sketch)\n", bucket_num);
     }
@@ -76,8 +79,9 @@ private:
         return (oneForEachCell(cellbit * 2) << cellbit) | oneForEachCell(cellbit * 2);
     }
 
+    /// @brief the cell of the key in table i, any of the bucket_num * CellsPerBucket cells.
     inline uint32_t CalculatePos(uint32_t key, int i) {
-        return (key * seeds[i]) >> 15;
+        return fastRange(multiplyShift(key, seeds[i]), bucket_num * CellsPerBucket);
     }
 };
 
@@ -88,8 +92,8 @@ void ClockSketch<use_counter>::updateTime(double time) {
         la_time = now;
         return;
     }
-    int d = now - la_time;
-    if (d >= (int)bucket_num * CellsPerBucket * CellBits) {
+    int64_t d = now - la_time;
+    if (d >= int64_t(bucket_num) * CellsPerBucket * CellBits) {
         memset(buckets, 0, bucket_num * sizeof(*buckets));
         la_time = now;
         return;
@@ -123,7 +127,7 @@ bool ClockSketch<false>::insert(int key, double time) {
     updateTime(time);
     bool ans = 0;
     for (int i = 0; i < TableNum; ++i) {
-        int pos = CalculatePos(key, i) % (bucket_num * CellsPerBucket);
+        uint32_t pos = CalculatePos(key, i);
         uint64_t msk = CellMask << (pos % CellsPerBucket * CellBits);
         if ((buckets[pos / CellsPerBucket] & msk) == 0)
             ans = 1;
@@ -142,7 +146,7 @@ int ClockSketch<true>::insert_cnt(int key, double time) {
     updateTime(time);
     int min_cnt = MaxReportSize;
     for (int i = 0; i < TableNum; ++i) {
-        int pos = CalculatePos(key, i) % (bucket_num * CellsPerBucket);
+        uint32_t pos = CalculatePos(key, i);
         uint64_t one = uint64_t(1) << (pos % CellsPerBucket * CellBits);
         uint64_t msk = one * CellMask;
         bool is_new = !(buckets[pos / CellsPerBucket] & msk);
@@ -15,7 +15,7 @@ class SWAMP<key_t, time_t, false> {
 
 public:
     SWAMP(uint32_t memory, time_t time_threshold_): 
-            tot(memory / (sizeof(key_t) + sizeof(typename Table::Node))),
+            tot(largest_fitting(memory, [](int n) { return n * sizeof(key_t) + Table::bytes(n + 5); })),
             time_threshold(time_threshold_),
             last_time(tot + 5) {
         q = new key_t[tot];
@@ -59,7 +59,7 @@ class SWAMP<key_t, time_t, true> {
 
 public:
     SWAMP(uint32_t memory, time_t time_threshold)
-        : tot(memory / (sizeof(key_t) + sizeof(typename Table::Node))),
+        : tot(largest_fitting(memory, [](int n) { return n * sizeof(key_t) + Table::bytes(n + 5); })),
           time_threshold(time_threshold), last_time(tot + 5) {
         q = new key_t[tot];
     }
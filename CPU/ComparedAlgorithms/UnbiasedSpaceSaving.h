@@ -8,31 +8,32 @@
 #include <random>
 
 #include "../lib/HashTable.h"
+#include "../lib/StreamSummary.h"
 
 using namespace std;
 
-#define tail_node SS_nodes[0].val_prev
-
 class UnbiasedSpaceSaving {
+	using Summary = StreamSummary<uint32_t>;
+	using SS_Index = Summary::Index;
+	static constexpr SS_Index SS_Nil = Summary::Header;
+
+	// values and value order of the nodes are kept in the StreamSummary
 	struct SS_Node {
 		uint32_t key;
 		int16_t delta;
-		uint32_t val;
-		SS_Node* val_prev;
-		SS_Node* val_next;
-		SS_Node* val_parent;
-		SS_Node* key_next;
+		SS_Index key_next;
 	};
 	struct Info {
 		float last_batch_time, last_item_time;
 		int count; //count appear in circular array or SS
-		SS_Node* first_SS_node;
+		SS_Index first_SS_node;
 		Info(float _last_batch_time = 0, float _last_item_time = 0, int _count = 1,
-			SS_Node* _first_SS_node = nullptr): last_batch_time(_last_batch_time), last_item_time(_last_item_time), count(_count), first_SS_node(_first_SS_node) {}
+			SS_Index _first_SS_node = SS_Nil): last_batch_time(_last_batch_time), last_item_time(_last_item_time), count(_count), first_SS_node(_first_SS_node) {}
 	};
 
 	int now_element, capacity;
 	SS_Node* SS_nodes;
+	Summary stream_summary;
 	Hash_table<uint32_t, Info> hash_table;
 	mt19937 rng;
 
@@ -57,34 +58,29 @@ class UnbiasedSpaceSaving {
 	void append_new_key(uint32_t key, int16_t delta, float time, int freq, Info& info) {
 		if (now_element < capacity) {
 			info.count++;
-			int idx = ++now_element; // we use 0 to represent header
-			auto np = SS_nodes + idx;
-			np->key = key;
-			np->delta = delta;
-			np->val = 0;
-			np->key_next = info.first_SS_node;
+			SS_Index np = ++now_element; // we use 0 to represent header
+			SS_nodes[np].key = key;
+			SS_nodes[np].delta = delta;
+			SS_nodes[np].key_next = info.first_SS_node;
 			info.first_SS_node = np;
 
 			// append to tail
-			np->val_prev = tail_node;
-			tail_node->val_next = np;
-			np->val_next = SS_nodes;
-			np->val_parent = np;
-			tail_node = np;
-			add_counter(tail_node, freq);
+			stream_summary.append(np, freq);
 		} else {
-			if (rng() % (tail_node->val + 1) == 0) {
+			SS_Index tail = stream_summary.tail();
+			if (rng() % (stream_summary.value(tail) + 1) == 0) {
 				info.count++;
 				replace_new_key(key, delta, time);
-				tail_node->key_next = info.first_SS_node;
-				info.first_SS_node = tail_node;
+				SS_nodes[tail].key_next = info.first_SS_node;
+				info.first_SS_node = tail;
 			}
-			add_counter(tail_node, freq);
+			stream_summary.add(tail, freq);
 		}
 	}
 
 	void replace_new_key(uint32_t key, int16_t delta, float time) {
-		uint32_t old_key = tail_node->key;
+		SS_Index tail = stream_summary.tail();
+		uint32_t old_key = SS_nodes[tail].key;
 		auto it = hash_table.find(old_key);
 		if (it == hash_table.end()) {
 			fprintf(stderr, "LINE %d: hash_table.find(old_key) == hash_table.end()\n",
@@ -94,59 +90,27 @@ class UnbiasedSpaceSaving {
 		if (!--(it->second.count)) {
 			hash_table.erase(it);
 		} else {
-			SS_Node* p = it->second.first_SS_node;
-			if (p == tail_node) {
-				it->second.first_SS_node = tail_node->key_next;
+			SS_Index p = it->second.first_SS_node;
+			if (p == tail) {
+				it->second.first_SS_node = SS_nodes[tail].key_next;
 			} else {
-				while (p->key_next != tail_node) p = p->key_next;
-				p->key_next = tail_node->key_next;
+				while (SS_nodes[p].key_next != tail) p = SS_nodes[p].key_next;
+				SS_nodes[p].key_next = SS_nodes[tail].key_next;
 			}
 		}
-		tail_node->key = key;
-		tail_node->delta = delta;
-	}
-
-	void add_counter(SS_Node* my, int freq) {
-		if (my->val_parent == my && my->val_next->val == my->val) {
-			SS_Node *p = my->val_next, *nt = my->val_next;
-			while (p && p->val == my->val) {
-				p->val_parent = nt;
-				p = p->val_next;
-			}
-		}
-
-		my->val += freq;
-		SS_Node* prev_node = my->val_prev;
-
-		if (prev_node->val > my->val) {
-			return;
-		}
-
-		SS_Node* next_node = my->val_next;
-
-		// make next and prev connect
-		prev_node->val_next = my->val_next;
-		next_node->val_prev = my->val_prev;
-
-		while (prev_node->val < my->val) {
-			prev_node = prev_node->val_parent->val_prev;
-		}
-
-		next_node = prev_node->val_next;
-
-		my->val_next = prev_node->val_next;
-		prev_node->val_next = my;
-
-		my->val_prev = next_node->val_prev;
-		next_node->val_prev = my;
-
-		my->val_parent = (prev_node->val == my->val) ? prev_node->val_parent : my;
+		SS_nodes[tail].key = key;
+		SS_nodes[tail].delta = delta;
 	}
 
 public:
 	UnbiasedSpaceSaving(double batch_time, double unit_time,
 		int memory, int _circular_array_size, int seed): now_element(0),
-														 capacity((memory - _circular_array_size * (sizeof(uint32_t) + sizeof(Hash_table<uint32_t, Info>::Node))) / (sizeof(SS_Node) + sizeof(int) * 2 + sizeof(Hash_table<uint32_t, Info>::Node)) - 1),
+														 capacity(largest_fitting(memory, [&](int c) {
+															 return _circular_array_size * sizeof(uint32_t) +
+																 (c + 1) * (sizeof(SS_Node) + Summary::BytesPerCounter + sizeof(int) * 2) +
+																 Hash_table<uint32_t, Info>::bytes(c + _circular_array_size + 5);
+														 })),
+														 stream_summary(capacity),
 														 hash_table(capacity + _circular_array_size + 5),
 														 rng(seed),
 														 circular_array_size(_circular_array_size),
@@ -155,9 +119,6 @@ public:
 		SS_nodes = new SS_Node[capacity + 1];
 		memset(SS_nodes, 0, (capacity + 1) * sizeof(SS_Node));
 		now_element = 0;
-		SS_nodes[0].val = -1;
-		SS_nodes[0].val_parent = SS_nodes;
-		tail_node = SS_nodes;
 
 		circular_array = new uint32_t[circular_array_size];
 		memset(circular_array, 0, circular_array_size * sizeof(uint32_t));
@@ -187,9 +148,9 @@ public:
 			}
 			int16_t delta = (time - itr->second.last_batch_time) / UNIT_TIME;
 			itr->second.last_item_time = itr->second.last_batch_time = time;
-			for (SS_Node* p = itr->second.first_SS_node; p; p = p->key_next)
-				if (p->delta == delta) {
-					add_counter(p, freq);
+			for (SS_Index p = itr->second.first_SS_node; p != SS_Nil; p = SS_nodes[p].key_next)
+				if (SS_nodes[p].delta == delta) {
+					stream_summary.add(p, freq);
 					return 1;
 				}
 			append_new_key(key, delta, time, freq, itr->second);
@@ -201,19 +162,16 @@ public:
 	vector<pair<pair<int, int16_t>, int>> get_top_k(int k) const {
 		vector<pair<pair<int, int16_t>, int>> ans(k);
 
-		SS_Node* idx = SS_nodes[0].val_next;
+		SS_Index idx = stream_summary.first();
 		int i;
-		int mn_v = 1e9;
 		for (i = 0; i < k && i < capacity && i < now_element; ++i) {
-			ans[i] = { { idx->key, idx->delta }, idx->val };
-			idx = idx->val_next;
-			mn_v = min(mn_v, (int)idx->val);
+			ans[i] = { { SS_nodes[idx].key, SS_nodes[idx].delta }, int(stream_summary.value(idx)) };
+			idx = stream_summary.next(idx);
 		}
 		for (; i < k; ++i)
 			ans[i] = {};
 		return ans;
 	}
 };
-#undef tail_node
 
 #endif //_UNBIASEDSPACESAVING_H_
\ No newline at end of file
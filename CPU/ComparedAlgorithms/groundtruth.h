@@ -28,8 +28,12 @@ enum RecordPos : int {
 #define REC_POS RecordPos::START
 #endif
 
+// The functions below take any random access range of Records, such as a
+// vector<Record> or a MappedTrace.
+
+template <typename Trace = vector<Record>>
 void adjust_params(
-	const vector<Record>& input,
+	const Trace& input,
 	double& batch_time_threshold,
 	double& unit_time
 ) {
@@ -37,7 +41,7 @@ void adjust_params(
 	if (!batch_time_threshold) {
 		double sum = 0;
 		int cnt = 0;
-		for (auto& [key, time] : input) {
+		for (auto [key, time] : input) {
 			if (la.count(key)) {
 				sum += time - la[key];
 				++cnt;
@@ -51,10 +55,11 @@ void adjust_params(
 	}
 }
 
-map<ItemKey, int> item_count(const vector<Record>& input) {
+template <typename Trace = vector<Record>>
+map<ItemKey, int> item_count(const Trace& input) {
 	map<ItemKey, int> cnt;
 	int max_cnt = 0;
-	for (auto& [key, time] : input) {
+	for (auto [key, time] : input) {
 		max_cnt = max(max_cnt, ++cnt[key]);
 	}
 	printf("Freq. of the hottest item = %d\n", max_cnt);
@@ -63,15 +68,16 @@ map<ItemKey, int> item_count(const vector<Record>& input) {
 	return cnt;
 }
 
+template <typename Trace = vector<Record>>
 vector<int> realtime_size(
-	const vector<Record>& input,
+	const Trace& input,
 	double BATCH_TIME_THRESHOLD
 ) {
 	map<ItemKey, double> last_time;
 	map<ItemKey, int> last_cnt;
 	vector<int> realtime_sizes;
 	int max_size = 0;
-	for (auto& [key, time] : input) {
+	for (auto [key, time] : input) {
 		if (last_time.count(key) && time - last_time[key] <= BATCH_TIME_THRESHOLD) {
 			max_size = max(max_size, ++last_cnt[key]);
 		} else {
@@ -84,9 +90,9 @@ vector<int> realtime_size(
 	return realtime_sizes;
 }
 
-template <RecordPos recordPos = RecordPos(REC_POS)>
+template <RecordPos recordPos = RecordPos(REC_POS), typename Trace = vector<Record>>
 pair<vector<Index>, vector<Index>> batch(
-	const vector<Record>& input,
+	const Trace& input,
 	double BATCH_TIME_THRESHOLD,
 	int BATCH_SIZE_THRESHOLD
 ) {
@@ -119,8 +125,9 @@ pair<vector<Index>, vector<Index>> batch(
 
 #undef REC_POS
 
+template <typename Trace = vector<Record>>
 map<ItemKey, vector<BatchTimeRange>> item_batches(
-	const vector<Record>& input,
+	const Trace& input,
 	double time_threshold,
 	int size_threshold
 ) {
@@ -148,8 +155,9 @@ map<ItemKey, vector<BatchTimeRange>> item_batches(
 	return item_batches;
 }
 
+template <typename Trace = vector<Record>>
 vector<pair<PeriodicKey, int>> topk(
-	const vector<Record>& input,
+	const Trace& input,
 	const vector<Index>& batches,
 	double UNIT_TIME,
 	int TOPK_THRESHOLD
@@ -1,42 +1,97 @@
 #ifndef _CALMSPACESAVING_H_
 #define _CALMSPACESAVING_H_
 
+#include <algorithm>
+#include <climits>
 #include <cstdlib>
+#include <stdexcept>
 #include <vector>
 
-#include "HashTable.h"
+#include "CalmSummary.h"
+#include "ChangeFeed.h"
+#include "../lib/FastRange.h"
+#include "../lib/HashTable.h"
+#include "../lib/SlotCountIndex.h"
+#include "../lib/StreamSummary.h"
 
 using namespace std;
 
-#define tail_node SS_nodes[0].val_prev
+/// @brief a (key, delta) pair, the unit CalmSS counts.
+template <typename Key>
+struct KeyDelta {
+	Key key;
+	int16_t delta;
+	bool operator==(const KeyDelta& other) const {
+		return key == other.key && delta == other.delta;
+	}
+};
+
+template <typename Key>
+struct KeyHash<KeyDelta<Key>> {
+	uint32_t operator()(const KeyDelta<Key>& kd) const {
+		uint64_t h = uint64_t(KeyHash<Key>()(kd.key)) << 16 | uint16_t(kd.delta);
+		return key_hash_detail::fold64(h * key_hash_detail::kMul);
+	}
+};
 
+// Keys of any type with a KeyHash can be used, @see KeyHash
+//
+// Nodes are numbered by 32-bit indices. The (key, delta) of a counter is in
+// SS_nodes, while its value and the value order live in a StreamSummary
+// under the same index. SS node 0 is the header of the value list. Every
+// (key, delta) monitored in SS or the LRU queue is found through node_index,
+// so a batch start, a promotion from the LRU queue and an eviction each
+// take one lookup, however many periods a key has.
+//
+// LRU slots are filed by count in a SlotCountIndex, so the slot to reuse,
+// the first one of the smallest count from the queue head on, is found
+// without scanning the queue.
+//
+// With a last-seen cache (pending_size > 0), insert_deferred holds back the
+// in-batch items of recently seen keys, so they cost no hash table lookup
+// and no TimeRecorder update. A key keeps its last item time in the cache,
+// so batch starts are found from the same times as with insert. What
+// changes is the TimeRecorder: a run of held-back items takes one slot, when
+// the key leaves the cache, instead of one slot per item, so keys stay in it
+// for more items, and a key dropped while its items were held back is
+// tracked again when they are written back.
+template <typename Key = uint32_t>
 class CalmSpaceSaving {
 protected:
+	using Summary = StreamSummary<uint32_t>;
+	using SS_Index = Summary::Index;
+	using LRU_Index = int32_t;
+	static constexpr SS_Index SS_Nil = Summary::Header;
+	static constexpr LRU_Index LRU_Nil = -1;
+
 	struct SS_Node {
-		uint32_t key;
+		Key key;
 		int16_t delta;
-		uint32_t val;
-		SS_Node* val_prev;
-		SS_Node* val_next;
-		SS_Node* val_parent;
-		SS_Node* key_next;
 	};
 
 	struct LRU_Node {
-		uint32_t key;
+		Key key;
 		int16_t delta;
 		int16_t count;
-		LRU_Node* next;
+	};
+
+	/// @brief where a (key, delta) is monitored, in SS or in the LRU queue.
+	struct Place {
+		SS_Index ss = SS_Nil;
+		LRU_Index lru = LRU_Nil;
+	};
+
+	struct Pending {
+		Key key;
+		float last_batch_time, last_item_time;
+		int deferred; // items held back, -1 for a free slot
 	};
 
 	struct Info {
 		float last_batch_time, last_item_time;
 		int count; // count appear in circular array or LRU queue or SS
-		SS_Node* first_SS_node;
-		LRU_Node* first_LRU_node;
-		Info(float _last_batch_time = 0, float _last_item_time = 0, int _count = 1,
-			SS_Node* _first_SS_node = nullptr, LRU_Node* _first_LRU_node = nullptr)
-			: last_batch_time(_last_batch_time), last_item_time(_last_item_time), count(_count), first_SS_node(_first_SS_node), first_LRU_node(_first_LRU_node) {}
+		Info(float _last_batch_time = 0, float _last_item_time = 0, int _count = 1)
+			: last_batch_time(_last_batch_time), last_item_time(_last_item_time), count(_count) {}
 	};
 
 	double time_threshold, unit_time;
@@ -44,22 +99,62 @@ protected:
 	int now_element;
 	const int capacity;
 	SS_Node* SS_nodes;
-	Hash_table<uint32_t, Info> hash_table;
+	Summary stream_summary;
+	Hash_table<Key, Info> hash_table;
+	Hash_table<KeyDelta<Key>, Place> node_index;
 
-	uint32_t* circular_array;
+	Key* circular_array;
 	int circular_array_head;
 	const int circular_array_size;
 
 	LRU_Node* LRU_queue;
 	int LRU_queue_head;
 	const int count_threshold, LRU_queue_size;
+	SlotCountIndex LRU_counts;
+
+	Pending* pending;
+	const int pending_size;
+
+	ChangeFeed<Key>* feed = nullptr;
+	uint32_t feed_threshold = 1;
+
+	// an LRU count stays below count_threshold, but a new slot starts at 1
+	static int LRU_count_levels(int count_threshold) {
+		return max(count_threshold, 2);
+	}
+
+	void set_LRU_count(LRU_Index p, int16_t count) {
+		LRU_counts.move(p, LRU_queue[p].count, count);
+		LRU_queue[p].count = count;
+	}
+
+	// drop a reference of SS or the LRU queue to the TimeRecorder entry of key
+	void release(const Key& key) {
+		auto itr = hash_table.find(key);
+		if (itr != hash_table.end() && !--(itr->second.count))
+			hash_table.erase(itr);
+	}
+
+	void reset_counters() {
+		fill(SS_nodes, SS_nodes + capacity + 1, SS_Node());
+		now_element = 0;
+		stream_summary.clear();
+
+		fill(LRU_queue, LRU_queue + LRU_queue_size, LRU_Node());
+		LRU_counts.clear();
+		for (int i = 0; i < LRU_queue_size; ++i)
+			LRU_counts.insert(i, 0);
+		LRU_queue_head = 0;
+
+		node_index.clear();
+	}
 
 	// record new key to circular array, remove old key from hash table
-	void array_push(uint32_t new_key) {
-		uint32_t old_key = circular_array[circular_array_head];
+	void array_push(const Key& new_key) {
+		Key old_key = circular_array[circular_array_head];
 		circular_array[circular_array_head] = new_key;
 		(++circular_array_head) %= circular_array_size;
-		if (old_key) {
+		if (old_key != Key()) {
 			auto itr = hash_table.find(old_key);
 			if (!--(itr->second.count)) {
 				hash_table.erase(itr);
@@ -67,48 +162,27 @@ protected:
 		}
 	}
 
-	void append_new_key(uint32_t key, int16_t delta, float time, int freq,
-		Info& info) {
+	void append_new_key(const Key& key, int16_t delta, float time, int freq,
+		Info& info, Place& place) {
 		info.count++;
 		if (now_element < capacity) {
-			int idx = ++now_element; // we use 0 to represent header
-			auto np = SS_nodes + idx;
-			np->key = key;
-			np->delta = delta;
-			np->val = 0;
-			np->key_next = info.first_SS_node;
-			info.first_SS_node = np;
+			SS_Index np = ++now_element; // we use 0 to represent header
+			SS_nodes[np].key = key;
+			SS_nodes[np].delta = delta;
+			place = { np, LRU_Nil };
 
 			// append to tail
-			np->val_prev = tail_node;
-			tail_node->val_next = np;
-			np->val_next = SS_nodes;
-			np->val_parent = np;
-			tail_node = np;
-			add_counter(tail_node, freq);
+			stream_summary.append(np, freq);
+			if (feed && uint32_t(freq) >= feed_threshold)
+				publish(np, ChangeType::Enter);
 		}
 		else {
-			// insert to LRU queue
-			LRU_Node* np = LRU_queue + LRU_queue_head;
+			// insert to LRU queue, replacing the first slot of the smallest
+			// count from the head on
+			LRU_Index np = LRU_counts.find_min(LRU_queue_head);
 			(++LRU_queue_head) %= LRU_queue_size;
-			if (np->count) {
-				for (int i = LRU_queue_head; i < LRU_queue_size; ++i)
-					if (LRU_queue[i].count < np->count) {
-						np = LRU_queue + i;
-						if (!np->count)
-							break;
-					}
-				if (np->count) {
-					for (int i = 0; i < LRU_queue_head; ++i)
-						if (LRU_queue[i].count < np->count) {
-							np = LRU_queue + i;
-							if (!np->count)
-								break;
-						}
-				}
-			}
-			if (np->count) {
-				uint32_t old_key = np->key;
+			if (LRU_queue[np].count) {
+				Key old_key = LRU_queue[np].key;
 				auto itr = hash_table.find(old_key);
 				if (itr == hash_table.end()) {
 					fprintf(stderr,
@@ -116,201 +190,398 @@ protected:
 						__LINE__);
 					exit(0);
 				}
-				if (!--(itr->second.count)) {
+				if (!--(itr->second.count))
 					hash_table.erase(itr);
-				}
-				else {
-					LRU_Node* p = itr->second.first_LRU_node;
-					if (p == np) {
-						itr->second.first_LRU_node = np->next;
-					}
-					else {
-						while (p && p->next != np)
-							p = p->next;
-						if (p == nullptr) {
-							fprintf(stderr, "LINE %d: p == nullptr\n", __LINE__);
-							exit(0);
-						}
-						p->next = np->next;
-					}
-				}
+				node_index.erase({ old_key, LRU_queue[np].delta });
 			}
-			np->key = key;
-			np->delta = delta;
-			np->count = 1;
-			np->next = info.first_LRU_node;
-			info.first_LRU_node = np;
+			LRU_queue[np].key = key;
+			LRU_queue[np].delta = delta;
+			set_LRU_count(np, 1);
+			place = { SS_Nil, np };
 		}
 	}
 
-	void replace_new_key(uint32_t key, int16_t delta, float time) {
-		uint32_t old_key = tail_node->key;
+	void replace_new_key(const Key& key, int16_t delta, float time, Place& place) {
+		SS_Index old_tail = stream_summary.tail();
+		Key old_key = SS_nodes[old_tail].key;
+		if (feed && stream_summary.value(old_tail) >= feed_threshold)
+			publish(old_tail, ChangeType::Leave);
 		auto it = hash_table.find(old_key);
 		if (it != hash_table.end()) {
 			if (!--(it->second.count)) {
 				hash_table.erase(it);
 			}
-			else {
-				SS_Node* p = it->second.first_SS_node;
-				if (p == tail_node) {
-					it->second.first_SS_node = tail_node->key_next;
-				}
-				else {
-					while (p && p->key_next != tail_node)
-						p = p->key_next;
-					if (p == nullptr) {
-						fprintf(stderr, "LINE %d: p == nullptr\n", __LINE__);
-						exit(0);
-					}
-					p->key_next = tail_node->key_next;
-				}
-			}
 		}
-		tail_node->key = key;
-		tail_node->delta = delta;
+		node_index.erase({ old_key, SS_nodes[old_tail].delta });
+		SS_nodes[old_tail].key = key;
+		SS_nodes[old_tail].delta = delta;
+		place = { old_tail, LRU_Nil };
 	}
 
-	void add_counter(SS_Node* my, int freq) {
-		if (my->val_parent == my && my->val_next->val == my->val) {
-			SS_Node *p = my->val_next, *nt = my->val_next;
-			while (p && p->val == my->val) {
-				p->val_parent = nt;
-				p = p->val_next;
-			}
+	// count a batch start of key with period delta, true if it was counted
+	// in SS rather than in the LRU queue or as a new (key, delta)
+	bool count_period(const Key& key, int16_t delta, float time, int freq, Info& info) {
+		Place& place = node_index[{ key, delta }];
+		if (place.ss != SS_Nil) {
+			add_counter(place.ss, freq);
+			return 1;
 		}
-
-		my->val += freq;
-		SS_Node* prev_node = my->val_prev;
-
-		if (prev_node->val > my->val) {
-			return;
+		if (place.lru == LRU_Nil) {
+			append_new_key(key, delta, time, freq, info, place);
+			return 0;
 		}
+		LRU_Index p = place.lru;
+		LRU_Node& node = LRU_queue[p];
+		if (node.count + 1 < count_threshold) {
+			set_LRU_count(p, node.count + 1);
+			return 0;
+		}
+		// promote to SS, taking the counter of the tail
+		node.key = Key();
+		set_LRU_count(p, 0);
+		replace_new_key(key, delta, time, place);
+		add_counter(stream_summary.tail(), count_threshold, true);
+		return 1;
+	}
 
-		SS_Node* next_node = my->val_next;
-
-		// make next and prev connect
-		prev_node->val_next = my->val_next;
-		next_node->val_prev = my->val_prev;
+	int pending_slot(const Key& key) const {
+		return fastRange(multiplyShift(KeyHash<Key>()(key), 0x9e3779b97f4a7c15), pending_size);
+	}
 
-		while (prev_node && prev_node->val < my->val) {
-			prev_node = prev_node->val_parent->val_prev;
+	// push the items held back for a key into the TimeRecorder as one item
+	void write_back(Pending& e) {
+		if (e.deferred > 0) {
+			auto itr = hash_table.find(e.key);
+			if (itr == hash_table.end()) {
+				// dropped from the TimeRecorder while its items were held back
+				hash_table[e.key] = Info(e.last_batch_time, e.last_item_time);
+			}
+			else {
+				itr->second.count++;
+				itr->second.last_item_time = e.last_item_time;
+			}
+			array_push(e.key);
 		}
-		assert(prev_node);
+		e.deferred = -1;
+	}
 
-		next_node = prev_node->val_next;
+	bool insert_at(typename Hash_table<Key, Info>::Node* itr, const Key& key, float time,
+		bool bf_new, int freq) {
+		if (itr == hash_table.end()) {
+			// key not found
+			if (!bf_new)
+				return 0;
+			array_push(key);
+			hash_table[key] = Info(time, time);
+			if (now_element < capacity)
+				append_new_key(key, -1, time, 0, hash_table[key], node_index[{ key, -1 }]);
+		}
+		else {
+			itr->second.count++; // array count++
+			// key found
+			array_push(key);
+			if (time - itr->second.last_item_time < time_threshold) {
+				itr->second.last_item_time = time;
+				return 0;
+			}
+			int16_t delta = (time - itr->second.last_batch_time) / unit_time;
+			itr->second.last_item_time = itr->second.last_batch_time = time;
+			count_period(key, delta, time, freq, itr->second);
+		}
+		return 1;
+	}
 
-		my->val_next = prev_node->val_next;
-		prev_node->val_next = my;
+	// links of snapshots are checked before use
+	template <typename Index>
+	static Index checked_link(Index i, Index lo, int n) {
+		if (i < lo || i >= Index(n))
+			throw std::invalid_argument("Snapshot: link out of range");
+		return i;
+	}
 
-		my->val_prev = next_node->val_prev;
-		next_node->val_prev = my;
+	// fresh is set for a counter just taken over by a new (key, delta),
+	// which the feed has not reported yet whatever its value
+	void add_counter(SS_Index my, int freq, bool fresh = false) {
+		if (!feed) {
+			stream_summary.add(my, freq);
+			return;
+		}
+		bool reported = !fresh && stream_summary.value(my) >= feed_threshold;
+		stream_summary.add(my, freq);
+		if (stream_summary.value(my) >= feed_threshold)
+			publish(my, reported ? ChangeType::Update : ChangeType::Enter);
+	}
 
-		my->val_parent = (prev_node->val == my->val) ? prev_node->val_parent : my;
+	void publish(SS_Index i, ChangeType type) {
+		feed->publish({ ReportKey<Key>(SS_nodes[i].key), SS_nodes[i].delta, type,
+			stream_summary.value(i) });
 	}
 
 public:
+	// The number of SS counters that fit in memory beside the other tables
+	static int counters_for(int memory, int count_threshold, int q_size,
+		int circular_array_size, int pending_size = 0) {
+		return largest_fitting(memory, [&](int c) {
+			// the tables as allocated by the constructor, with their power-of-two slots
+			return q_size * sizeof(LRU_Node) +
+				SlotCountIndex::bytes(q_size, LRU_count_levels(count_threshold)) +
+				circular_array_size * sizeof(Key) +
+				pending_size * sizeof(Pending) +
+				(c + 1) * (sizeof(SS_Node) + Summary::BytesPerCounter + sizeof(int) * 2) +
+				Hash_table<Key, Info>::bytes(c + circular_array_size + q_size + 5) +
+				Hash_table<KeyDelta<Key>, Place>::bytes(c + q_size + 5);
+		});
+	}
+
 	CalmSpaceSaving(double _time_threshold, double _unit_time,
 		int memory, int _count_threshold, int q_size,
-		int _circular_array_size): time_threshold(_time_threshold),
+		int _circular_array_size, int _pending_size = 0): time_threshold(_time_threshold),
 								   unit_time(_unit_time),
 								   now_element(0),
-								   capacity((memory - q_size * sizeof(LRU_Node) -
-												_circular_array_size * sizeof(uint32_t) -
-												(q_size + _circular_array_size) *
-													sizeof(Hash_table<uint32_t, Info>::Node)) /
-										   (sizeof(SS_Node) + sizeof(int) * 2 +
-											   sizeof(Hash_table<uint32_t, Info>::Node)) -
-									   1),
+								   capacity(counters_for(memory, _count_threshold, q_size,
+									   _circular_array_size, _pending_size)),
+								   stream_summary(capacity),
 								   hash_table(capacity + _circular_array_size + q_size + 5),
+								   node_index(capacity + q_size + 5),
 								   circular_array_size(_circular_array_size),
 								   count_threshold(_count_threshold),
-								   LRU_queue_size(q_size) {
+								   LRU_queue_size(q_size),
+								   LRU_counts(q_size, LRU_count_levels(_count_threshold)),
+								   pending_size(_pending_size) {
 
         printf("c = %d\t (Length of the TimeRecorder queue)\n",circular_array_size);
         printf("w = %d\t (Length of the LRU queue in CalmSS)\n",q_size);
-		SS_nodes = new SS_Node[capacity + 1] {};
-		now_element = 0;
-		SS_nodes[0].val = -1;
-		SS_nodes[0].val_parent = SS_nodes;
-		tail_node = SS_nodes;
-
-		circular_array = new uint32_t[circular_array_size] {};
-		circular_array_head = 0;
-
-		LRU_queue = new LRU_Node[q_size] {};
-		LRU_queue_head = 0;
+        if (pending_size)
+            printf("L = %d\t (Slots of the last-seen cache in CalmSS)\n", pending_size);
+		SS_nodes = new SS_Node[capacity + 1];
+		circular_array = new Key[circular_array_size];
+		LRU_queue = new LRU_Node[q_size];
+		pending = new Pending[pending_size];
+		clear();
 	}
 	~CalmSpaceSaving() {
 		delete[] SS_nodes;
 		delete[] circular_array;
 		delete[] LRU_queue;
+		delete[] pending;
 	}
 
-	bool insert(uint32_t key, float time, bool bf_new, int freq = 1) {
-		auto itr = hash_table.find(key);
-		if (itr == hash_table.end()) {
-			// key not found
-			if (!bf_new)
-				return 0;
-			array_push(key);
-			hash_table[key] = Info(time, time);
-			if (now_element < capacity)
-				append_new_key(key, -1, time, 0, hash_table[key]);
+	// Forget everything counted, as after construction
+	void clear() {
+		reset_counters();
+
+		fill(circular_array, circular_array + circular_array_size, Key());
+		circular_array_head = 0;
+
+		for (int i = 0; i < pending_size; ++i)
+			pending[i].deferred = -1;
+
+		hash_table.clear();
+	}
+
+	// Forget the counts of SS and the LRU queue but keep the TimeRecorder,
+	// so the next batch start of a key it still holds counts a period from
+	// its last batch. Pairs watched by a feed leave it.
+	void clear_counters() {
+		for (SS_Index i = 1; i <= SS_Index(now_element); ++i) {
+			if (feed && stream_summary.value(i) >= feed_threshold)
+				publish(i, ChangeType::Leave);
+			release(SS_nodes[i].key);
 		}
-		else {
-			itr->second.count++; // array count++
-			// key found
-			array_push(key);
-			if (time - itr->second.last_item_time < time_threshold) {
-				itr->second.last_item_time = time;
+		for (int i = 0; i < LRU_queue_size; ++i)
+			if (LRU_queue[i].count)
+				release(LRU_queue[i].key);
+		reset_counters();
+	}
+
+	bool insert(const Key& key, float time, bool bf_new, int freq = 1) {
+		return insert_at(hash_table.find(key), key, time, bf_new, freq);
+	}
+
+	/// @brief insert, holding back the in-batch items of the keys in the last-seen cache.
+	/// @details needs pending_size > 0, @see CalmSpaceSaving
+	bool insert_deferred(const Key& key, float time, bool bf_new) {
+		Pending& e = pending[pending_slot(key)];
+		if (e.deferred >= 0 && e.key == key) {
+			if (!bf_new && time - e.last_item_time < time_threshold) {
+				e.last_item_time = time;
+				++e.deferred;
 				return 0;
 			}
-			int16_t delta = (time - itr->second.last_batch_time) / unit_time;
-			itr->second.last_item_time = itr->second.last_batch_time = time;
-			for (SS_Node* p = itr->second.first_SS_node; p; p = p->key_next)
-				if (p->delta == delta) {
-					add_counter(p, freq);
-					return 1;
-				}
-			for (LRU_Node *p = itr->second.first_LRU_node, *prev_p = nullptr; p;
-				 p = p->next) {
-				if (p->delta == delta) {
-					if (++(p->count) >= count_threshold) {
-						p->key = p->count = 0;
-						if (p == itr->second.first_LRU_node)
-							itr->second.first_LRU_node = p->next;
-						else
-							prev_p->next = p->next;
-						replace_new_key(key, delta, time);
-						tail_node->key_next = itr->second.first_SS_node;
-						itr->second.first_SS_node = tail_node;
-						add_counter(tail_node, count_threshold);
-					}
-					return 1;
-				}
-				prev_p = p;
-			}
-			append_new_key(key, delta, time, freq, itr->second);
+			write_back(e);
 		}
-		return 1;
+		auto itr = hash_table.find(key);
+		if (insert_at(itr, key, time, bf_new, 1))
+			return 1;
+		if (itr != hash_table.end()) {
+			// an in-batch item of a tracked key, hold back the next ones
+			Pending next = { key, itr->second.last_batch_time, itr->second.last_item_time, 0 };
+			write_back(e);
+			e = next;
+		}
+		return 0;
 	}
 
 	// Return <<key, delta>, frequency> key-value pairs
-	vector<pair<pair<int, int16_t>, int>> get_top_k(int k) const {
-		vector<pair<pair<int, int16_t>, int>> ans(k);
-
-		SS_Node* idx = SS_nodes[0].val_next;
-		int i;
-		for (i = 0; i < k && i < capacity && i < now_element; ++i) {
-			ans[i] = { { idx->key, idx->delta }, idx->val };
-			idx = idx->val_next;
-		}
-		for (; i < k; ++i)
-			ans[i] = {};
+	TopKList<Key> get_top_k(int k) const {
+		TopKList<Key> ans(k);
+		auto last = top_k(ans.begin(), k);
+		fill(last, ans.end(), TopKEntry<Key>());
 		return ans;
 	}
 
+	// Write the largest min(k, now_element) <<key, delta>, frequency> pairs
+	// into out, in decreasing order of frequency, without allocating.
+	// Return the iterator past the last one written.
+	template <typename OutputIt>
+	OutputIt top_k(OutputIt out, int k) const {
+		SS_Index idx = stream_summary.first();
+		for (int i = 0; i < k && i < now_element; ++i) {
+			*out++ = TopKEntry<Key>{ { SS_nodes[idx].key, SS_nodes[idx].delta }, int(stream_summary.value(idx)) };
+			idx = stream_summary.next(idx);
+		}
+		return out;
+	}
+
+	// Like top_k, but write the pairs of frequency >= threshold, at most
+	// limit of them. The counters are sorted, so the walk stops at the first
+	// one below threshold.
+	template <typename OutputIt>
+	OutputIt top_k_above(OutputIt out, int threshold, int limit = INT_MAX) const {
+		SS_Index idx = stream_summary.first();
+		for (int i = 0; i < limit && i < now_element; ++i) {
+			int freq = stream_summary.value(idx);
+			if (freq < threshold)
+				break;
+			*out++ = TopKEntry<Key>{ { SS_nodes[idx].key, SS_nodes[idx].delta }, freq };
+			idx = stream_summary.next(idx);
+		}
+		return out;
+	}
+
+	// The number of counters in SS, the most pairs a feed can watch at once
+	int ss_capacity() const {
+		return capacity;
+	}
+
+	// Publish the changes of the (key, delta) pairs counted at least
+	// threshold into feed as they happen, or stop with feed = nullptr.
+	// The pairs already above threshold are not replayed, a consumer starts
+	// from top_k_above. The feed is not part of snapshots.
+	void subscribe(ChangeFeed<Key>* _feed, uint32_t threshold = 1) {
+		feed = _feed;
+		feed_threshold = max(threshold, 1u);
+	}
+
+	// Write the whole state into a snapshot, @see Snapshot::Writer
+	template <typename Writer>
+	void save(Writer& w) const {
+		w.write(time_threshold);
+		w.write(unit_time);
+		w.write(capacity);
+		w.write(circular_array_size);
+		w.write(count_threshold);
+		w.write(LRU_queue_size);
+		w.write(now_element);
+		w.write(circular_array_head);
+		w.write(LRU_queue_head);
+		for (int i = 0; i <= capacity; ++i) {
+			const SS_Node& node = SS_nodes[i];
+			w.write(node.key);
+			w.write(node.delta);
+		}
+		stream_summary.save(w);
+		w.write_array(circular_array, circular_array_size);
+		for (int i = 0; i < LRU_queue_size; ++i) {
+			const LRU_Node& node = LRU_queue[i];
+			w.write(node.key);
+			w.write(node.delta);
+			w.write(node.count);
+		}
+		w.write(pending_size);
+		for (int i = 0; i < pending_size; ++i) {
+			const Pending& e = pending[i];
+			w.write(e.key);
+			w.write(e.last_batch_time);
+			w.write(e.last_item_time);
+			w.write(e.deferred);
+		}
+		hash_table.save(w, [&](const Info& info) {
+			w.write(info.last_batch_time);
+			w.write(info.last_item_time);
+			w.write(info.count);
+		});
+		node_index.save(w, [&](const Place& place) {
+			w.write(place.ss);
+			w.write(place.lru);
+		});
+	}
+
+	// Restore a snapshot of a CalmSpaceSaving built with the same parameters
+	template <typename Reader>
+	void load(Reader& r) {
+		r.expect(time_threshold, "time threshold");
+		r.expect(unit_time, "unit time");
+		r.expect(capacity, "CalmSS capacity");
+		r.expect(circular_array_size, "TimeRecorder length");
+		r.expect(count_threshold, "LRU count threshold");
+		r.expect(LRU_queue_size, "LRU queue length");
+		now_element = r.template read<int>();
+		circular_array_head = r.template read<int>();
+		LRU_queue_head = r.template read<int>();
+		int ss_n = capacity + 1;
+		for (int i = 0; i < ss_n; ++i) {
+			SS_Node& node = SS_nodes[i];
+			node.key = r.template read<Key>();
+			node.delta = r.template read<int16_t>();
+		}
+		stream_summary.load(r);
+		r.read_array(circular_array, circular_array_size);
+		LRU_counts.clear();
+		for (int i = 0; i < LRU_queue_size; ++i) {
+			LRU_Node& node = LRU_queue[i];
+			node.key = r.template read<Key>();
+			node.delta = r.template read<int16_t>();
+			node.count = checked_link(r.template read<int16_t>(), int16_t(0),
+				LRU_count_levels(count_threshold));
+			LRU_counts.insert(i, node.count);
+		}
+		r.expect(pending_size, "last-seen cache size");
+		for (int i = 0; i < pending_size; ++i) {
+			Pending& e = pending[i];
+			e.key = r.template read<Key>();
+			e.last_batch_time = r.template read<float>();
+			e.last_item_time = r.template read<float>();
+			e.deferred = r.template read<int>();
+			if (e.deferred < -1)
+				throw std::invalid_argument("Snapshot: bad last-seen cache entry");
+		}
+		hash_table.load(r, [&](Info& info) {
+			info.last_batch_time = r.template read<float>();
+			info.last_item_time = r.template read<float>();
+			info.count = r.template read<int>();
+		});
+		node_index.load(r, [&](Place& place) {
+			place.ss = checked_link(r.template read<SS_Index>(), SS_Nil, ss_n);
+			place.lru = checked_link(r.template read<LRU_Index>(), LRU_Nil, LRU_queue_size);
+		});
+	}
+
+	// Export the monitored <key, delta> entries for merging, @see CalmSummary
+	CalmSummary<Key> summary() const {
+		CalmSummary<Key> res;
+		res.capacity = capacity;
+		res.min_count = now_element == capacity ? stream_summary.value(stream_summary.tail()) : 0;
+		SS_Index idx = stream_summary.first();
+		for (int i = 0; i < now_element; ++i) {
+			uint32_t val = stream_summary.value(idx);
+			if (val)
+				res.entries.push_back({ SS_nodes[idx].key, SS_nodes[idx].delta, val });
+			idx = stream_summary.next(idx);
+		}
+		return res;
+	}
+
 };
-#undef tail_node
 
 #endif // _CALMSPACESAVING_H_
\ No newline at end of file
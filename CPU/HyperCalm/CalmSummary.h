@@ -0,0 +1,145 @@
+#ifndef _CALMSUMMARY_H_
+#define _CALMSUMMARY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "../lib/KeyHash.h"
+
+/// @brief Keys reported by get_top_k, 32-bit keys are reported as int.
+template <typename Key>
+using ReportKey = conditional_t<is_same_v<Key, uint32_t>, int, Key>;
+
+/// @brief a <<key, delta>, frequency> pair reported by get_top_k and top_k.
+template <typename Key>
+using TopKEntry = pair<pair<ReportKey<Key>, int16_t>, int>;
+
+/// @brief <<key, delta>, frequency> pairs reported by get_top_k.
+template <typename Key>
+using TopKList = vector<TopKEntry<Key>>;
+
+// CalmSummary is the exported content of a CalmSpaceSaving, the monitored
+// (key, delta) -> count entries, which can be shipped to another node and
+// merged with the summaries of other streams.
+//
+// Like Space-Saving, a count never underestimates, and overestimates by at
+// most min_count, where min_count is the smallest monitored count of a full
+// summary and 0 otherwise. Merging follows mergeable Space-Saving: the
+// estimate of an entry is the sum of its counts, with the min_count of the
+// summaries that do not monitor it, and only the largest `capacity` entries
+// are kept. The error of the result is then bounded by its min_count, which
+// is at most N / capacity for a merged stream of N periodic batches.
+template <typename Key = uint32_t>
+struct CalmSummary {
+    static_assert(is_trivially_copyable_v<Key>, "keys are serialized as bytes");
+
+    struct Entry {
+        Key key;
+        int16_t delta;
+        uint32_t count;
+    };
+
+    uint32_t capacity = 0;
+    uint32_t min_count = 0;
+    vector<Entry> entries; // sorted by count, descending
+
+    /// @brief Merge summaries into one monitoring at most `capacity` entries.
+    static CalmSummary merge(const vector<CalmSummary>& summaries, uint32_t capacity) {
+        CalmSummary res;
+        res.capacity = capacity;
+        uint32_t total_min = 0;
+        for (auto& s : summaries)
+            total_min += s.min_count;
+        unordered_map<pair<Key, int16_t>, size_t, EntryHash> index;
+        for (auto& s : summaries) {
+            for (auto& e : s.entries) {
+                auto [it, is_new] = index.emplace(make_pair(e.key, e.delta), res.entries.size());
+                if (is_new)
+                    res.entries.push_back({ e.key, e.delta, total_min });
+                // the count replaces the min_count assumed for this summary
+                res.entries[it->second].count += e.count - s.min_count;
+            }
+        }
+        auto by_count = [](const Entry& a, const Entry& b) { return a.count > b.count; };
+        stable_sort(res.entries.begin(), res.entries.end(), by_count);
+        res.min_count = total_min;
+        if (res.entries.size() > capacity) {
+            res.min_count = max(total_min, res.entries[capacity].count);
+            res.entries.resize(capacity);
+        }
+        return res;
+    }
+
+    /// @brief Return <<key, delta>, frequency> pairs like CalmSpaceSaving::get_top_k.
+    TopKList<Key> get_top_k(int k) const {
+        TopKList<Key> ans(k);
+        for (int i = 0; i < k && i < entries.size(); ++i)
+            ans[i] = { { entries[i].key, entries[i].delta }, int(entries[i].count) };
+        return ans;
+    }
+
+    /// @brief Serialize to bytes in host byte order.
+    vector<char> serialize() const {
+        uint32_t n = entries.size();
+        vector<char> buf(sizeof(uint32_t) * 3 + n * EntrySize);
+        char* p = buf.data();
+        write(p, capacity);
+        write(p, min_count);
+        write(p, n);
+        for (auto& e : entries) {
+            write(p, e.key);
+            write(p, e.delta);
+            write(p, e.count);
+        }
+        return buf;
+    }
+
+    static CalmSummary deserialize(const char* data, size_t size) {
+        CalmSummary res;
+        const char* end = data + size;
+        uint32_t n;
+        read(data, end, res.capacity);
+        read(data, end, res.min_count);
+        read(data, end, n);
+        if (size_t(end - data) != size_t(n) * EntrySize)
+            throw std::invalid_argument("CalmSummary: corrupted data");
+        res.entries.resize(n);
+        for (auto& e : res.entries) {
+            read(data, end, e.key);
+            read(data, end, e.delta);
+            read(data, end, e.count);
+        }
+        return res;
+    }
+
+private:
+    struct EntryHash {
+        size_t operator()(const pair<Key, int16_t>& id) const {
+            return uint64_t(KeyHash<Key>()(id.first)) << 16 | uint16_t(id.second);
+        }
+    };
+
+    static constexpr size_t EntrySize =
+        sizeof(Entry::key) + sizeof(Entry::delta) + sizeof(Entry::count);
+
+    template <typename T>
+    static void write(char*& p, T value) {
+        memcpy(p, &value, sizeof(T));
+        p += sizeof(T);
+    }
+
+    template <typename T>
+    static void read(const char*& p, const char* end, T& value) {
+        if (size_t(end - p) < sizeof(T))
+            throw std::invalid_argument("CalmSummary: corrupted data");
+        memcpy(&value, p, sizeof(T));
+        p += sizeof(T);
+    }
+};
+
+#endif // _CALMSUMMARY_H_
@@ -0,0 +1,87 @@
+#ifndef _CHANGEFEED_H_
+#define _CHANGEFEED_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "CalmSummary.h"
+#include "SPSCQueue.h"
+
+/// @brief how a (key, delta) crossed the watched count of a ChangeFeed.
+enum class ChangeType : uint8_t {
+    Enter,  // its count reached the threshold
+    Update, // its count grew while at or above the threshold
+    Leave,  // it was evicted from SS with a count at or above the threshold
+};
+
+/// @brief a change of a (key, delta) published by CalmSpaceSaving.
+template <typename Key = uint32_t>
+struct ChangeEvent {
+    ReportKey<Key> key;
+    int16_t delta;
+    ChangeType type;
+    uint32_t count;
+};
+
+// ChangeFeed carries the changes of the (key, delta) pairs whose count is at
+// least a threshold, published by a CalmSpaceSaving as it counts, to one
+// consumer thread that drains them at its own pace. Counts only grow until
+// a pair is evicted, so Enter, Update and Leave events replayed in order
+// keep the set of pairs above the threshold, as top_k_above would list it.
+//
+// The feed is a bounded ring, and the sketch never waits for the consumer:
+// events that find it full are dropped and counted. After a drop the pairs
+// replayed so far may hold stale counts or miss pairs for good, since a
+// pair that is not counted again publishes nothing more. A consumer that
+// sees dropped() grow must rebuild its pairs from top_k_above, read while
+// the sketch is not being updated, and go on replaying from there.
+//
+// suggest_capacity sizes the ring from the sketch: one event per SS counter
+// for the Enter or Leave of every pair that can be watched at once, and room
+// for each of them to be counted several times more, fewer the higher the
+// threshold, since a pair has to be counted threshold times before it is
+// watched at all.
+template <typename Key = uint32_t>
+class ChangeFeed {
+public:
+    static constexpr size_t DefaultCapacity = 4096;
+
+    /// @param capacity events the ring holds, rounded up to a power of 2
+    explicit ChangeFeed(size_t capacity = DefaultCapacity) : queue(capacity) {}
+
+    /// @brief a ring size for a CalmSS of ss_capacity counters watched from threshold.
+    static size_t suggest_capacity(size_t ss_capacity, uint32_t threshold) {
+        size_t per_counter = EventsPerCounter / std::max(threshold, 1u);
+        return std::max(DefaultCapacity, ss_capacity * std::max<size_t>(per_counter, 2));
+    }
+
+    size_t capacity() const {
+        return queue.capacity();
+    }
+
+    /// @brief push an event, or count it as dropped if the ring is full. Producer only.
+    void publish(const ChangeEvent<Key>& event) {
+        if (!queue.try_push(event))
+            lost.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    /// @brief process all published events by f, return the number processed. Consumer only.
+    template <typename Func>
+    size_t drain(Func&& f) {
+        return queue.consume(f);
+    }
+
+    /// @brief the number of events dropped because the ring was full.
+    uint64_t dropped() const {
+        return lost.load(std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t EventsPerCounter = 64;
+
+    SPSCQueue<ChangeEvent<Key>, DefaultCapacity> queue;
+    std::atomic<uint64_t> lost { 0 };
+};
+
+#endif // _CHANGEFEED_H_
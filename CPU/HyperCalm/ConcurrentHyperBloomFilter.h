@@ -0,0 +1,185 @@
+#ifndef _CONCURRENTHYPERBLOOMFILTER_H_
+#define _CONCURRENTHYPERBLOOMFILTER_H_
+
+#include <algorithm>
+#include <cstring>
+#include <random>
+
+#include "HyperBloomFilter.h"
+
+namespace HyperBF {
+
+// ConcurrentHyperBloomFilter is a HyperBloomFilter that many threads can
+// insert into at the same time without locks.
+//
+// Layout: the same cells, positions and memory as HyperBloomFilter<CellBits>
+// with counters synced with buckets, but the state word and the counter word
+// of a bucket sit side by side in 16 bytes, so that the update of a table
+// (lazy clear, new state, counter) is a single 16-byte CAS (cmpxchg16b).
+// With one thread, it reports exactly what HyperBloomFilter<CellBits> reports.
+//
+// Semantics:
+// - No update is lost, and a bucket always changes together with its counters.
+// - Each table sees its updates in some order, but the TableNum updates of
+//   one insert are not atomic as a whole and the order may differ between
+//   tables. Items of the same key inserted concurrently may thus each be
+//   reported as if inserted first, e.g. two racing first items of a batch may
+//   both be reported new. Items of one key from one thread keep their order.
+// - Timestamps decide the lazy-clear phase of each insert. A producer lagging
+//   behind a phase boundary clears the states just written by the others, so
+//   the skew between producers should be well below time_threshold.
+// - Memory order is relaxed, the filter does not publish any other data.
+template <size_t CellBits = 2>
+class ConcurrentHyperBloomFilter {
+protected:
+    static constexpr size_t TableNum = 8;
+
+    /// @brief states and counters of a bucket, updated as a whole.
+    struct alignas(16) Bucket {
+        uint64_t state;
+        uint64_t counter;
+    };
+
+public:
+    Bucket* buckets;
+    double time_threshold;
+    uint32_t bucket_num;
+    uint64_t seeds[TableNum + 1];
+
+protected:
+    static constexpr size_t CellPerBucket = sizeof(uint64_t) * 8 / CellBits;
+    static constexpr uint64_t CellMask = (1 << CellBits) - 1;
+    static_assert(kStateNum + 1 <= (1 << CellBits));
+    static_assert(CellBits <= 8);
+
+    static constexpr uint64_t getOnePerCell() {
+        uint64_t one = 0;
+        for (size_t i = 0; i < CellPerBucket; ++i)
+            one |= uint64_t(1) << (i * CellBits);
+        return one;
+    }
+
+    /// @brief The lowest bit of every cell.
+    static constexpr uint64_t OnePerCell = getOnePerCell();
+    /// @brief Every cell filled with state 1, 2, 3.
+    static constexpr uint64_t CellStates[kStateNum] = {
+        OnePerCell, OnePerCell * 2, OnePerCell * 3
+    };
+
+public:
+    /// @brief The maximum report size, the same as HyperBloomFilter<CellBits>.
+    static constexpr size_t MaxReportSize = CellMask + 1;
+
+    ConcurrentHyperBloomFilter(uint32_t memory, double time_threshold, int seed = 123);
+    ~ConcurrentHyperBloomFilter() {
+        delete[] buckets;
+    }
+
+    /// @brief insert the item and return batch size excluding current item.
+    /// @details thread safe, @see the semantics above the class.
+    /// @return the item count of the batch, 0 if current item is new.
+    int insert_cnt(int key, double time);
+    /// @brief insert the item and return whether it's new, thread safe.
+    bool insert(int key, double time);
+
+private:
+    using Word128 = unsigned __int128;
+
+    inline uint32_t CalculatePos(uint32_t key, int i) {
+        return multiplyShift(key, seeds[i]);
+    }
+
+    /// @brief 16-byte CAS, returns the value seen before the exchange.
+    __attribute__((target("cx16")))
+    static inline Word128 CompareAndSwap(Bucket* p, Word128 expected, Word128 desired) {
+        return __sync_val_compare_and_swap((Word128*)p, expected, desired);
+    }
+};
+
+
+template <size_t CellBits>
+ConcurrentHyperBloomFilter<CellBits>::ConcurrentHyperBloomFilter(
+    uint32_t memory, double time_threshold, int seed
+) : time_threshold(time_threshold) {
+    bucket_num = memory / sizeof(Bucket);
+    bucket_num -= bucket_num % TableNum;
+    buckets = new (std::align_val_t { 64 }) Bucket[bucket_num] {};
+    std::mt19937_64 rng(seed);
+    for (int i = 0; i <= TableNum; ++i) {
+        seeds[i] = randomOddSeed(rng);
+    }
+    if (memory >= 1024)
+        printf("Memory = %.1f KB\t (Memory used in HyperBF)\n", memory / 1000.0);
+    else
+        printf("Memory = %u B\t (Memory used in HyperBF)\n", memory);
+    printf("d = %d\t (Number of arrays in concurrent HyperBF)\n", bucket_num);
+}
+
+template <size_t CellBits>
+int ConcurrentHyperBloomFilter<CellBits>::insert_cnt(int key, double time) {
+    uint32_t first_bucket_pos = fastRange(CalculatePos(key, TableNum), bucket_num / TableNum) * TableNum;
+    int min_cnt = MaxReportSize;
+    for (int i = 0; i < TableNum; ++i) {
+        int cell_pos = CalculatePos(key, i) % CellPerBucket;
+        auto move_bits = CellBits * cell_pos;
+        Bucket* bucket_ptr = buckets + first_bucket_pos + i;
+
+        int now_tag = int(time / time_threshold + 1.0 * i / TableNum) % 3 + 1;
+        int ban_tag_m1 = now_tag % 3;
+
+        // a torn read only costs a retry, the CAS returns a consistent value
+        Bucket old_bucket {
+            __atomic_load_n(&bucket_ptr->state, __ATOMIC_RELAXED),
+            __atomic_load_n(&bucket_ptr->counter, __ATOMIC_RELAXED)
+        };
+        int report;
+        while (true) {
+            uint64_t diff_bits = old_bucket.state ^ CellStates[ban_tag_m1];
+            // 1 = any(not same), 0 = all(same), folded into the lowest bit of each cell
+            uint64_t is_ban_bits = diff_bits;
+            for (size_t j = 1; j < CellBits; ++j)
+                is_ban_bits |= diff_bits >> j;
+            is_ban_bits &= OnePerCell;
+            // if all(same), clear the states and the counters together
+            uint64_t mask = is_ban_bits * CellMask;
+            Bucket bucket { old_bucket.state & mask, old_bucket.counter & mask };
+
+            bool with_header = (bucket.state & (CellMask << move_bits));
+            bucket.state &= ~(CellMask << move_bits);
+            bucket.state |= uint64_t(now_tag) << move_bits;
+            if (!with_header) {
+                // leave the counter empty, state will record the header
+                report = 0;
+            } else {
+                int cnt = (bucket.counter >> move_bits) & CellMask;
+                report = cnt + 1; // add the header
+                if (cnt != CellMask) {
+                    bucket.counter ^= uint64_t(cnt + 1 ^ cnt) << move_bits;
+                }
+            }
+
+            Word128 expected, desired;
+            memcpy(&expected, &old_bucket, sizeof(Bucket));
+            memcpy(&desired, &bucket, sizeof(Bucket));
+            if (desired == expected)
+                break; // nothing changes, skip the write
+            Word128 seen = CompareAndSwap(bucket_ptr, expected, desired);
+            if (seen == expected)
+                break;
+            memcpy(&old_bucket, &seen, sizeof(Bucket));
+        }
+        min_cnt = std::min(min_cnt, report);
+    }
+    return min_cnt;
+}
+
+template <size_t CellBits>
+bool ConcurrentHyperBloomFilter<CellBits>::insert(int key, double time) {
+    return insert_cnt(key, time) == 0;
+}
+
+} // namespace HyperBF
+
+using HyperBF::ConcurrentHyperBloomFilter;
+
+#endif // _CONCURRENTHYPERBLOOMFILTER_H_
@@ -2,7 +2,13 @@
 #define _HYPERBLOOMFILTER_H_
 
 #include <immintrin.h>
+#include <algorithm>
 #include <random>
+#include <stdexcept>
+#include <type_traits>
+
+#include "../lib/FastRange.h"
+#include "../lib/KeyHash.h"
 
 namespace HyperBF {
 
@@ -23,8 +29,46 @@ enum CounterType {
     FastSync,
 };
 
+// SIMD kernels are compiled with per-function target attributes and chosen
+// at runtime, so the binary itself does not require AVX2 or AVX-512.
+// Define NO_SIMD to build the scalar kernel only.
+#if !defined(NO_SIMD) && defined(__x86_64__) && defined(__GNUC__)
+#define HYPERBF_SIMD_DISPATCH
+#define HYPERBF_TARGET_AVX2 __attribute__((target("avx2")))
+#define HYPERBF_TARGET_AVX512 __attribute__((target("avx512f")))
+#endif
+
+enum SimdLevel {
+    Scalar,
+    AVX2,
+    AVX512,
+};
+
+static constexpr const char* SIMD_LEVEL_NAMES[] = { "Scalar", "AVX2", "AVX-512" };
+
+/// @brief The widest kernel a new HyperBloomFilter may use, lower it to benchmark narrower ones.
+inline SimdLevel max_simd_level = AVX512;
+
+/// @brief The widest kernel supported by both the build and the running CPU.
+inline SimdLevel detectSimdLevel() {
+#ifdef HYPERBF_SIMD_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return AVX2;
+#endif
+    return Scalar;
+}
+
+/// @brief A time threshold in integer ticks, e.g. nanoseconds, @see HyperBloomFilter
+struct TickThreshold {
+    uint64_t ticks;
+};
+
 // HyperBloomFilter is a time-sensitive variant of Bloom Filter.
-template <size_t CellBits = 2, CounterType counterType = SyncWithBucket>
+// Keys of any type with a KeyHash are hashed to 32 bits once per insert.
+template <size_t CellBits = 2, CounterType counterType = SyncWithBucket, typename Key = uint32_t>
 class HyperBloomFilter {
 protected:
     static constexpr size_t TableNum = 8;
@@ -34,13 +78,28 @@ public:
     uint64_t* counters;
     double time_threshold;
     uint32_t bucket_num;
-    uint32_t seeds[TableNum + 1];
+    uint64_t seeds[TableNum + 1];
 
 protected:
     static constexpr size_t counter_type = counterType;
     static constexpr size_t CellPerBucket = sizeof(*buckets) * 8 / CellBits;
     static constexpr uint64_t CellMask = (1 << CellBits) - 1;
     static_assert(kStateNum + 1 <= (1 << CellBits));
+    static_assert(CellBits <= 8);
+
+    static constexpr uint64_t getOnePerCell() {
+        uint64_t one = 0;
+        for (size_t i = 0; i < CellPerBucket; ++i)
+            one |= uint64_t(1) << (i * CellBits);
+        return one;
+    }
+
+    /// @brief The lowest bit of every cell, spare bits above the last cell stay 0.
+    static constexpr uint64_t OnePerCell = getOnePerCell();
+    /// @brief Every cell filled with state 1, 2, 3, generalizes HyperBF::STATE_MASKS.
+    static constexpr uint64_t CellStates[kStateNum] = {
+        OnePerCell, OnePerCell * 2, OnePerCell * 3
+    };
 
     static constexpr size_t getSizePerBucket() {
         constexpr size_t bucket_size = sizeof(*buckets);
@@ -60,17 +119,18 @@ protected:
     }
 
 public:
-#ifdef SIMD
-    static constexpr bool use_simd = true;
-#else
-    static constexpr bool use_simd = false;
-#endif
     static constexpr bool use_counter = counterType != None;
 
     /// @brief The maximum report size.
     static constexpr size_t MaxReportSize = getMaxReportSize();
 
     HyperBloomFilter(uint32_t memory, double time_threshold, int seed = 123);
+    /// @brief build a filter for integer timestamps, @see insert_cnt_ticks
+    /// @details Timestamps and the threshold are counted in the same ticks, so
+    ///          tags come from integer compares instead of a floating division
+    ///          per table. The floating point interface stays usable, with
+    ///          time_threshold = threshold.ticks.
+    HyperBloomFilter(uint32_t memory, TickThreshold threshold, int seed = 123);
     ~HyperBloomFilter() {
         delete[] buckets;
         delete[] counters;
@@ -81,19 +141,172 @@ public:
     /// @param time current timestamp
     /// @attention report size is limited by MaxReportSize @see HyperBloomFilter::MaxReportSize
     /// @return the item count of the batch, 0 if current item is new.
-    int insert_cnt(int key, double time);
+    int insert_cnt(const Key& key, double time);
+    /// @brief insert count items of key at the same time, as count calls of insert_cnt do.
+    /// @details The first item may start a batch, the others add to its
+    ///          counter at once, saturating at MaxReportSize.
+    /// @return the item count of the batch before these items, 0 if they start a new batch.
+    int insert_cnt(const Key& key, double time, int count);
     /// @brief insert the item and return whether it's new.
-    bool insert(int key, double time);
+    bool insert(const Key& key, double time);
+    /// @brief insert_cnt with an integer timestamp.
+    /// @attention only for filters built with a TickThreshold, throws std::logic_error otherwise.
+    int insert_cnt_ticks(const Key& key, uint64_t tick);
+    /// @brief insert with an integer timestamp.
+    /// @attention only for filters built with a TickThreshold, throws std::logic_error otherwise.
+    bool insert_ticks(const Key& key, uint64_t tick);
+
+    /// @brief insert n items in order and write the batch size of each one.
+    /// @details The result is identical to calling insert_cnt item by item,
+    ///          but the bucket groups of the next PrefetchDistance items are
+    ///          prefetched while the current item is processed.
+    /// @param keys the keys of the items
+    /// @param times the timestamps of the items, float or double
+    /// @param n the number of items
+    /// @param cnts output, cnts[i] is the result of insert_cnt(keys[i], times[i])
+    template <typename Time>
+    void insert_cnt(const Key* keys, const Time* times, size_t n, int* cnts) {
+        static_assert(std::is_floating_point_v<Time>, "integer timestamps go to insert_cnt_ticks");
+        insert_cnt_batch<false>(keys, times, n, cnts);
+    }
+    /// @brief insert n items in order and write whether each one is new.
+    template <typename Time>
+    void insert(const Key* keys, const Time* times, size_t n, bool* is_new) {
+        static_assert(std::is_floating_point_v<Time>, "integer timestamps go to insert_ticks");
+        insert_batch<false>(keys, times, n, is_new);
+    }
+    /// @brief insert_cnt of n items with integer timestamps.
+    /// @attention only for filters built with a TickThreshold, throws std::logic_error otherwise.
+    void insert_cnt_ticks(const Key* keys, const uint64_t* ticks, size_t n, int* cnts) {
+        CheckTicks();
+        insert_cnt_batch<true>(keys, ticks, n, cnts);
+    }
+    /// @brief insert of n items with integer timestamps.
+    /// @attention only for filters built with a TickThreshold, throws std::logic_error otherwise.
+    void insert_ticks(const Key* keys, const uint64_t* ticks, size_t n, bool* is_new) {
+        CheckTicks();
+        insert_batch<true>(keys, ticks, n, is_new);
+    }
+
+    /// @brief OR-merge a filter built with the same memory, time threshold and seed.
+    /// @details Cells are read as of `time`, so cells with the banned tag are empty.
+    ///          A cell is set if it is set in either filter, the more recent tag
+    ///          wins, and when both cells hold the same tag their item counts
+    ///          are added, saturating at the counter width.
+    /// @param time the timestamp of the merge, no earlier than both filters' last insert
+    void merge(const HyperBloomFilter& other, double time);
+
+    /// @brief write the cells and counters into a snapshot, @see Snapshot::Writer
+    template <typename Writer>
+    void save(Writer& w) const {
+        w.write(uint32_t(CellBits));
+        w.write(uint32_t(counter_type));
+        w.write(bucket_num);
+        w.write(time_threshold);
+        w.write_array(seeds, TableNum + 1);
+        w.write_array(buckets, bucket_num);
+        if constexpr(use_counter)
+            w.write_array(counters, bucket_num);
+    }
+    /// @brief restore a snapshot of a filter built with the same parameters and seed.
+    template <typename Reader>
+    void load(Reader& r) {
+        r.expect(uint32_t(CellBits), "HyperBF cell bits");
+        r.expect(uint32_t(counter_type), "HyperBF counter type");
+        r.expect(bucket_num, "HyperBF size");
+        r.expect(time_threshold, "HyperBF time threshold");
+        for (auto seed : seeds)
+            r.expect(seed, "HyperBF seeds");
+        r.read_array(buckets, bucket_num);
+        if constexpr(use_counter)
+            r.read_array(counters, bucket_num);
+    }
+
+    /// @brief The number of items whose buckets are fetched ahead in batched insertion.
+    static constexpr size_t PrefetchDistance = 8;
+
+    /// @brief The kernel chosen at construction, @see HyperBF::detectSimdLevel
+    SimdLevel simd_level;
 
 private:
+    /// @brief The threshold of integer timestamps, 0 if not built with a TickThreshold.
+    uint64_t tick_threshold = 0;
+    /// @brief Table i enters the next phase when tick % threshold reaches tick_bounds[i].
+    uint64_t tick_bounds[TableNum];
+    /// @brief The tick range where the current tags hold.
+    uint64_t tick_segment_start = 0, tick_segment_len = 0;
+    /// @brief The current tag of each table and its banned cell state.
+    alignas(64) uint64_t tick_tags[TableNum];
+    alignas(64) uint64_t tick_bans[TableNum];
+
+    inline void UpdateTickPhase(uint64_t tick) {
+        // also recomputes when time goes backwards, since the difference wraps
+        if (tick - tick_segment_start >= tick_segment_len)
+            ResetTickPhase(tick);
+    }
+
+    void ResetTickPhase(uint64_t tick);
+    void CheckTicks() const {
+        if (!tick_threshold)
+            throw std::logic_error("HyperBloomFilter: integer timestamps need a TickThreshold");
+    }
+
+    /// @tparam Ticks times are integer ticks, @see insert_cnt_ticks
+    template <bool Ticks, typename Time>
+    void insert_cnt_batch(const Key* keys, const Time* times, size_t n, int* cnts);
+    template <bool Ticks, typename Time>
+    void insert_batch(const Key* keys, const Time* times, size_t n, bool* is_new);
+
     inline uint32_t CalculatePos(uint32_t key, int i) {
-        return (key * seeds[i]) >> 15;
+        return multiplyShift(key, seeds[i]);
+    }
+
+    /// @brief the first bucket of the key's group, reaches every group of any size.
+    inline uint32_t CalculateGroupPos(uint32_t key) {
+        return fastRange(CalculatePos(key, TableNum), bucket_num / TableNum) * TableNum;
+    }
+
+    inline void PrefetchGroup(uint32_t first_bucket_pos) {
+        __builtin_prefetch(buckets + first_bucket_pos, 1);
+        if constexpr(use_counter)
+            __builtin_prefetch(counters + first_bucket_pos, 1);
+    }
+
+    inline uint32_t HashKey(const Key& key) {
+        return KeyHash<Key>()(key);
     }
+
+    /// @brief insert_cnt with a hashed key and a precomputed bucket group position.
+    /// @tparam Ticks take the tags of tick_tags instead of computing them from time
+    template <bool Ticks = false>
+    inline int insert_cnt_at(uint32_t key, double time, uint32_t first_bucket_pos) {
+#ifdef HYPERBF_SIMD_DISPATCH
+        if (simd_level == AVX512)
+            return insert_cnt_avx512<Ticks>(key, time, first_bucket_pos);
+        if (simd_level == AVX2)
+            return insert_cnt_avx2<Ticks>(key, time, first_bucket_pos);
+#endif
+        return insert_cnt_scalar<Ticks>(key, time, first_bucket_pos);
+    }
+
+    /// @param weight the number of items inserted at once
+    template <bool Ticks>
+    int insert_cnt_scalar(uint32_t key, double time, uint32_t first_bucket_pos, int weight = 1);
+#ifdef HYPERBF_SIMD_DISPATCH
+    /// @brief processes the 8 tables as two 256-bit halves.
+    template <bool Ticks>
+    HYPERBF_TARGET_AVX2
+    int insert_cnt_avx2(uint32_t key, double time, uint32_t first_bucket_pos);
+    /// @brief processes the 8 tables in one 512-bit vector.
+    template <bool Ticks>
+    HYPERBF_TARGET_AVX512
+    int insert_cnt_avx512(uint32_t key, double time, uint32_t first_bucket_pos);
+#endif
 };
 
 
-template <size_t CellBits, CounterType counterType>
-HyperBloomFilter<CellBits, counterType>::HyperBloomFilter(
+template <size_t CellBits, CounterType counterType, typename Key>
+HyperBloomFilter<CellBits, counterType, Key>::HyperBloomFilter(
     uint32_t memory, double time_threshold, int seed
 ) : counters(nullptr), time_threshold(time_threshold) {
     bucket_num = memory / getSizePerBucket();
@@ -102,155 +315,437 @@ HyperBloomFilter<CellBits, counterType>::HyperBloomFilter(
     if constexpr(use_counter) {
         counters = new (std::align_val_t { 64 }) uint64_t[bucket_num] {};
     }
-    std::mt19937 rng(seed);
+    std::mt19937_64 rng(seed);
     for (int i = 0; i <= TableNum; ++i) {
-        seeds[i] = rng();
+        seeds[i] = randomOddSeed(rng);
     }
+    // a max_simd_level out of the enum falls back to the scalar kernel
+    simd_level = max_simd_level < Scalar || max_simd_level > AVX512
+        ? Scalar : std::min(detectSimdLevel(), max_simd_level);
     if (memory >= 1024)
         printf("Memory = %.1f KB\t (Memory used in HyperBF)\n", memory / 1000.0);
     else
         printf("Memory = %u B\t (Memory used in HyperBF)\n", memory);
     printf("d = %d\t (Number of arrays in HyperBF)\n", bucket_num);
+    printf("Kernel = %s\t (SIMD kernel of HyperBF)\n", SIMD_LEVEL_NAMES[simd_level]);
 }
 
-template <>
-int HyperBloomFilter<2>::insert_cnt(int key, double time) {
-    constexpr size_t CellBits = 2;
-    int first_bucket_pos = CalculatePos(key, TableNum) % bucket_num & ~(TableNum - 1);
-    int min_cnt = MaxReportSize, max_cnt = 0;
-    if constexpr(use_simd) {
-        static_assert(TableNum % 8 == 0);
-        #define _update_cnt(cnt, i) if constexpr (TableNum == 8) \
-            { cnt = (i); } else { cnt = std::min(cnt, (i)); }
-        #define _generate_vector(gen) _mm512_set_epi64( \
-            gen(7), gen(6), gen(5), gen(4), \
-            gen(3), gen(2), gen(1), gen(0) \
-        )
-        // Normally, we don't need to take a loop here, indent is unnecessary.
-        // For readability, we use a new line to separate the loop body.
-        for (int batch_start = 0; batch_start < TableNum; batch_start += 8) {
-
-        double time_base = time / time_threshold + 1.0 * batch_start / TableNum;
-        #define _now_tag(i) (int(time_base + 1.0 * i / TableNum) % 3 + 1)
-        #define _tag_idx(i) (_now_tag(i) % 3)
-        #define _msk(i) (STATE_MASKS[_tag_idx(i)])
-        __m512i* x = (__m512i*)(buckets + first_bucket_pos + batch_start);
-        __m512i cache = *x;
-        __m512i is_ban_bits = _generate_vector(_msk);
-        is_ban_bits ^= cache;
-        is_ban_bits |= is_ban_bits >> 1;
-        is_ban_bits &= ODD_BIT_MASK; // broadcast by default
-        __m512i mask = is_ban_bits | (is_ban_bits << 1);
-        cache &= mask;
-        #define _bits(i) ((CalculatePos(key, i) % CellPerBucket) * CellBits)
-        __m512i move_bits = _generate_vector(_bits);
-        __m512i now_tags = _generate_vector(_now_tag);
+template <size_t CellBits, CounterType counterType, typename Key>
+HyperBloomFilter<CellBits, counterType, Key>::HyperBloomFilter(
+    uint32_t memory, TickThreshold threshold, int seed
+) : HyperBloomFilter(memory, double(threshold.ticks), seed) {
+    tick_threshold = threshold.ticks;
+    for (int i = 0; i < TableNum; ++i)
+        tick_bounds[i] = tick_threshold - tick_threshold * i / TableNum;
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+void HyperBloomFilter<CellBits, counterType, Key>::ResetTickPhase(uint64_t tick) {
+    // the same tags as int(time / time_threshold + 1.0 * i / TableNum) % 3 + 1,
+    // table i is one phase ahead once tick % threshold >= tick_bounds[i]
+    const uint64_t threshold = tick_threshold;
+    uint64_t cycle_pos = tick % (threshold * 3);
+    int phase = cycle_pos / threshold;
+    uint64_t phase_pos = cycle_pos % threshold;
+    // tables [0, ahead) are still in phase, the bounds are decreasing
+    int ahead = 0;
+    while (ahead < TableNum && tick_bounds[ahead] > phase_pos)
+        ++ahead;
+    uint64_t lower = ahead < TableNum ? tick_bounds[ahead] : 0;
+    uint64_t upper = tick_bounds[ahead - 1];
+    tick_segment_start = tick - (phase_pos - lower);
+    tick_segment_len = upper - lower;
+    for (int i = 0; i < TableNum; ++i) {
+        int now_tag = (phase + (i >= ahead)) % 3 + 1;
+        tick_tags[i] = now_tag;
+        tick_bans[i] = CellStates[now_tag % 3];
+    }
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+int HyperBloomFilter<CellBits, counterType, Key>::insert_cnt(const Key& key, double time) {
+    uint32_t hkey = HashKey(key);
+    return insert_cnt_at(hkey, time, CalculateGroupPos(hkey));
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+int HyperBloomFilter<CellBits, counterType, Key>::insert_cnt_ticks(const Key& key, uint64_t tick) {
+    CheckTicks();
+    UpdateTickPhase(tick);
+    uint32_t hkey = HashKey(key);
+    return insert_cnt_at<true>(hkey, 0, CalculateGroupPos(hkey));
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+int HyperBloomFilter<CellBits, counterType, Key>::insert_cnt(const Key& key, double time, int count) {
+    uint32_t hkey = HashKey(key);
+    if (count == 1)
+        return insert_cnt_at(hkey, time, CalculateGroupPos(hkey));
+    // the SIMD kernels count one item at a time
+    return insert_cnt_scalar<false>(hkey, time, CalculateGroupPos(hkey), count);
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+template <bool Ticks>
+int HyperBloomFilter<CellBits, counterType, Key>::insert_cnt_scalar(
+    uint32_t key, double time, uint32_t first_bucket_pos, int weight
+) {
+    int min_cnt = MaxReportSize;
+    for (int i = 0; i < TableNum; ++i) {
+        int cell_pos = CalculatePos(key, i) % CellPerBucket;
+        int bucket_pos = (first_bucket_pos + i);
+
+        int now_tag;
+        if constexpr(Ticks)
+            now_tag = tick_tags[i];
+        else
+            now_tag = int(time / time_threshold + 1.0 * i / TableNum) % 3 + 1;
+        int ban_tag_m1 = now_tag % 3;
+
+        uint64_t diff_bits = buckets[bucket_pos] ^ CellStates[ban_tag_m1];
+        // 1 = any(not same), 0 = all(same), folded into the lowest bit of each cell
+        uint64_t is_ban_bits = diff_bits;
+        for (size_t j = 1; j < CellBits; ++j)
+            is_ban_bits |= diff_bits >> j;
+        is_ban_bits &= OnePerCell;
+        // if all(same), clear
+        uint64_t mask = is_ban_bits * CellMask;
+        uint64_t bucket = buckets[bucket_pos];
+        bucket &= mask;
+
+        auto move_bits = CellBits * cell_pos;
         if constexpr(counter_type == None) {
-            __m512i old_tags = cache & (CellMask << move_bits); // broadcast and vectorize
-            if (_mm512_reduce_min_epu64(old_tags) == 0)
+            int old_tag = (bucket >> move_bits) & CellMask;
+            if (old_tag == 0)
                 min_cnt = 0;
-            *x = cache ^ old_tags ^ (now_tags << move_bits); // vectorized shift
-        } else if constexpr(counter_type == FastSync) {
-            cache &= ~(CellMask << move_bits);
-            cache |= now_tags << move_bits;
-            *x = cache;
-
-            x = (__m512i*)(counters + first_bucket_pos + batch_start);
-            cache = *x;
-            cache &= mask;
-            cache = _mm512_rorv_epi64(cache, move_bits);
-            __m512i cnts = cache & CellMask;
-            _update_cnt(min_cnt, int(_mm512_reduce_min_epu64(cnts)));
-            __mmask8 add_mask = _mm512_cmpneq_epi64_mask(cnts, _mm512_set1_epi64(CellMask));
-            __m512i new_cnts = _mm512_mask_add_epi64(cnts, add_mask,
-                                                     cnts, _mm512_set1_epi64(1));
-            *x = _mm512_rolv_epi64(cache ^ cnts ^ new_cnts, move_bits);
+            bucket ^= uint64_t(now_tag ^ old_tag) << move_bits;
+            buckets[bucket_pos] = bucket;
         } else {
-            __m512i old_tags = cache & (CellMask << move_bits);
-            __mmask8 with_header = _mm512_cmpneq_epi64_mask(old_tags, _mm512_set1_epi64(0));
-            *x = cache ^ old_tags ^ (now_tags << move_bits);
-
-            x = (__m512i*)(counters + first_bucket_pos + batch_start);
-            cache = *x;
-            cache &= mask;
-            cache = _mm512_rorv_epi64(cache, move_bits);
-            __m512i cnts = cache & CellMask;
-            __m512i real_cnts = _mm512_maskz_add_epi64(
-                with_header, cnts, _mm512_set1_epi64(1));
-            _update_cnt(min_cnt, int(_mm512_reduce_min_epu64(real_cnts)));
-            __mmask8 max_mask = _mm512_cmpeq_epi64_mask(cnts, _mm512_set1_epi64(CellMask));
-            __m512i new_cnts = _mm512_mask_set1_epi64(real_cnts, max_mask, CellMask);
-            *x = _mm512_rolv_epi64(cache ^ cnts ^ new_cnts, move_bits);
-        }
-        #undef _bits
-        #undef _now_tag
-        #undef _tag_idx
-        #undef _msk
-
-        } // end of loop
-        #undef _generate_vector
-        #undef _update_cnt
-    } else {
-        for (int i = 0; i < TableNum; ++i) {
-            int cell_pos = CalculatePos(key, i) % CellPerBucket;
-            int bucket_pos = (first_bucket_pos + i);
-
-            int now_tag = int(time / time_threshold + 1.0 * i / TableNum) % 3 + 1;
-            int ban_tag_m1 = now_tag % 3;
-
-            uint64_t is_ban_bits = buckets[bucket_pos] ^ STATE_MASKS[ban_tag_m1];
-            // 1 = any(not same), 0 = all(same)
-            is_ban_bits |= is_ban_bits >> 1;
-            is_ban_bits &= ODD_BIT_MASK;
-            // if all(same), clear
-            uint64_t mask = is_ban_bits | (is_ban_bits << 1);
-            uint64_t bucket = buckets[bucket_pos];
-            bucket &= mask;
+            bool with_header = false;
+            if constexpr(counter_type == SyncWithBucket) {
+                with_header = (bucket & (CellMask << move_bits));
+            }
+            bucket &= ~(CellMask << move_bits);
+            bucket |= uint64_t(now_tag) << move_bits;
+            buckets[bucket_pos] = bucket;
 
-            auto move_bits = CellBits * cell_pos;
-            if constexpr(counter_type == None) {
-                int old_tag = (bucket >> move_bits) & CellMask;
-                if (old_tag == 0)
+            uint64_t counter = counters[bucket_pos];
+            counter &= mask;
+            if constexpr(counter_type == SyncWithBucket) {
+                if (!with_header) {
                     min_cnt = 0;
-                bucket ^= uint64_t(now_tag ^ old_tag) << move_bits;
-                buckets[bucket_pos] = bucket;
-            } else {
-                bool with_header = false;
-                if constexpr(counter_type == SyncWithBucket) {
-                    with_header = (bucket & (CellMask << move_bits));
-                }
-                bucket &= ~(CellMask << move_bits);
-                bucket |= uint64_t(now_tag) << move_bits;
-                buckets[bucket_pos] = bucket;
-
-                uint64_t counter = counters[bucket_pos];
-                counter &= mask;
-                if constexpr(counter_type == SyncWithBucket) {
-                    if (!with_header) {
-                        min_cnt = 0;
-                        // leave the counter empty, state will record the header,
-                        // so that we can know whether it's a new batch.
-                        counters[bucket_pos] = counter;
-                        continue;
+                    // leave the counter empty, state will record the header,
+                    // so that we can know whether it's a new batch. The
+                    // other items of a weighted insert go to the counter.
+                    if (weight > 1) {
+                        int cnt = (counter >> move_bits) & CellMask;
+                        int next = std::min<int>(cnt + weight - 1, CellMask);
+                        counter ^= uint64_t(next ^ cnt) << move_bits;
                     }
+                    counters[bucket_pos] = counter;
+                    continue;
                 }
-                int cnt = (counter >> move_bits) & CellMask;
-                min_cnt = std::min(min_cnt, cnt + with_header); // add the header
-                if (cnt != CellMask) {
-                    counter ^= uint64_t(cnt + 1 ^ cnt) << move_bits;
-                }
-                counters[bucket_pos] = counter;
             }
+            int cnt = (counter >> move_bits) & CellMask;
+            min_cnt = std::min(min_cnt, cnt + with_header); // add the header
+            if (cnt != CellMask) {
+                int next = weight == 1 ? cnt + 1 : std::min<int>(cnt + weight, CellMask);
+                counter ^= uint64_t(next ^ cnt) << move_bits;
+            }
+            counters[bucket_pos] = counter;
         }
     }
     return min_cnt;
 }
 
-template <size_t CellBits, CounterType counterType>
-bool HyperBloomFilter<CellBits, counterType>::insert(int key, double time) {
+#ifdef HYPERBF_SIMD_DISPATCH
+template <size_t CellBits, CounterType counterType, typename Key>
+template <bool Ticks>
+HYPERBF_TARGET_AVX512
+int HyperBloomFilter<CellBits, counterType, Key>::insert_cnt_avx512(
+    uint32_t key, double time, uint32_t first_bucket_pos
+) {
+    int min_cnt = MaxReportSize;
+    static_assert(TableNum % 8 == 0);
+    #define _update_cnt(cnt, i) if constexpr (TableNum == 8) \
+        { cnt = (i); } else { cnt = std::min(cnt, (i)); }
+    #define _generate_vector(gen) _mm512_set_epi64( \
+        gen(7), gen(6), gen(5), gen(4), \
+        gen(3), gen(2), gen(1), gen(0) \
+    )
+    // Normally, we don't need to take a loop here, indent is unnecessary.
+    // For readability, we use a new line to separate the loop body.
+    for (int batch_start = 0; batch_start < TableNum; batch_start += 8) {
+
+    double time_base = time / time_threshold + 1.0 * batch_start / TableNum;
+    #define _now_tag(i) (int(time_base + 1.0 * i / TableNum) % 3 + 1)
+    #define _tag_idx(i) (_now_tag(i) % 3)
+    #define _msk(i) (CellStates[_tag_idx(i)])
+    __m512i* x = (__m512i*)(buckets + first_bucket_pos + batch_start);
+    __m512i cache = *x;
+    __m512i diff_bits, now_tags;
+    if constexpr(Ticks) {
+        diff_bits = _mm512_load_si512(tick_bans + batch_start);
+        now_tags = _mm512_load_si512(tick_tags + batch_start);
+    } else {
+        diff_bits = _generate_vector(_msk);
+        now_tags = _generate_vector(_now_tag);
+    }
+    diff_bits ^= cache;
+    __m512i is_ban_bits = diff_bits;
+    for (size_t j = 1; j < CellBits; ++j)
+        is_ban_bits |= diff_bits >> j;
+    is_ban_bits &= OnePerCell; // broadcast by default
+    __m512i mask = is_ban_bits;
+    for (size_t j = 1; j < CellBits; ++j)
+        mask |= is_ban_bits << j;
+    cache &= mask;
+    #define _bits(i) ((CalculatePos(key, i) % CellPerBucket) * CellBits)
+    __m512i move_bits = _generate_vector(_bits);
+    if constexpr(counter_type == None) {
+        __m512i old_tags = cache & (CellMask << move_bits); // broadcast and vectorize
+        if (_mm512_reduce_min_epu64(old_tags) == 0)
+            min_cnt = 0;
+        *x = cache ^ old_tags ^ (now_tags << move_bits); // vectorized shift
+    } else if constexpr(counter_type == FastSync) {
+        cache &= ~(CellMask << move_bits);
+        cache |= now_tags << move_bits;
+        *x = cache;
+
+        x = (__m512i*)(counters + first_bucket_pos + batch_start);
+        cache = *x;
+        cache &= mask;
+        cache = _mm512_rorv_epi64(cache, move_bits);
+        __m512i cnts = cache & CellMask;
+        _update_cnt(min_cnt, int(_mm512_reduce_min_epu64(cnts)));
+        __mmask8 add_mask = _mm512_cmpneq_epi64_mask(cnts, _mm512_set1_epi64(CellMask));
+        __m512i new_cnts = _mm512_mask_add_epi64(cnts, add_mask,
+                                                 cnts, _mm512_set1_epi64(1));
+        *x = _mm512_rolv_epi64(cache ^ cnts ^ new_cnts, move_bits);
+    } else {
+        __m512i old_tags = cache & (CellMask << move_bits);
+        __mmask8 with_header = _mm512_cmpneq_epi64_mask(old_tags, _mm512_set1_epi64(0));
+        *x = cache ^ old_tags ^ (now_tags << move_bits);
+
+        x = (__m512i*)(counters + first_bucket_pos + batch_start);
+        cache = *x;
+        cache &= mask;
+        cache = _mm512_rorv_epi64(cache, move_bits);
+        __m512i cnts = cache & CellMask;
+        __m512i real_cnts = _mm512_maskz_add_epi64(
+            with_header, cnts, _mm512_set1_epi64(1));
+        _update_cnt(min_cnt, int(_mm512_reduce_min_epu64(real_cnts)));
+        __mmask8 max_mask = _mm512_cmpeq_epi64_mask(cnts, _mm512_set1_epi64(CellMask));
+        __m512i new_cnts = _mm512_mask_set1_epi64(real_cnts, max_mask, CellMask);
+        *x = _mm512_rolv_epi64(cache ^ cnts ^ new_cnts, move_bits);
+    }
+    #undef _bits
+    #undef _now_tag
+    #undef _tag_idx
+    #undef _msk
+
+    } // end of loop
+    #undef _generate_vector
+    #undef _update_cnt
+    return min_cnt;
+}
+
+// Unsigned min of four 64-bit lanes whose values fit in 32 bits,
+// AVX2 has no 64-bit unsigned min so only the low halves are compared.
+HYPERBF_TARGET_AVX2
+static inline int reduceMinSmallEpu64(__m256i v) {
+    __m128i x = _mm_min_epu32(_mm256_castsi256_si128(v), _mm256_extracti128_si256(v, 1));
+    x = _mm_min_epu32(x, _mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+    return _mm_cvtsi128_si32(x);
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+template <bool Ticks>
+HYPERBF_TARGET_AVX2
+int HyperBloomFilter<CellBits, counterType, Key>::insert_cnt_avx2(
+    uint32_t key, double time, uint32_t first_bucket_pos
+) {
+    constexpr size_t HalfNum = 4;
+    static_assert(TableNum % HalfNum == 0);
+    int min_cnt = MaxReportSize;
+    double time_base = time / time_threshold;
+    #define _generate_vector(gen) _mm256_set_epi64x( \
+        gen(half + 3), gen(half + 2), gen(half + 1), gen(half) \
+    )
+    #define _now_tag(i) (int(time_base + 1.0 * (i) / TableNum) % 3 + 1)
+    #define _tag_idx(i) (_now_tag(i) % 3)
+    #define _msk(i) (CellStates[_tag_idx(i)])
+    #define _bits(i) ((CalculatePos(key, (i)) % CellPerBucket) * CellBits)
+    const __m256i zeros = _mm256_setzero_si256();
+    const __m256i ones = _mm256_set1_epi64x(1);
+    const __m256i full_cnts = _mm256_set1_epi64x(CellMask);
+    // The same steps as the AVX-512 kernel on 4 tables at a time, the
+    // rotates become shifts since a counter never wraps around the word.
+    for (int half = 0; half < TableNum; half += HalfNum) {
+
+    __m256i* x = (__m256i*)(buckets + first_bucket_pos + half);
+    __m256i cache = *x;
+    __m256i diff_bits, now_tags;
+    if constexpr(Ticks) {
+        diff_bits = _mm256_load_si256((const __m256i*)(tick_bans + half));
+        now_tags = _mm256_load_si256((const __m256i*)(tick_tags + half));
+    } else {
+        diff_bits = _generate_vector(_msk);
+        now_tags = _generate_vector(_now_tag);
+    }
+    diff_bits ^= cache;
+    __m256i is_ban_bits = diff_bits;
+    for (size_t j = 1; j < CellBits; ++j)
+        is_ban_bits |= diff_bits >> j;
+    is_ban_bits &= OnePerCell;
+    __m256i mask = is_ban_bits;
+    for (size_t j = 1; j < CellBits; ++j)
+        mask |= is_ban_bits << j;
+    cache &= mask;
+    __m256i move_bits = _generate_vector(_bits);
+    if constexpr(counter_type == None) {
+        __m256i old_tags = cache & (CellMask << move_bits);
+        __m256i is_empty = _mm256_cmpeq_epi64(old_tags, zeros);
+        if (!_mm256_testz_si256(is_empty, is_empty))
+            min_cnt = 0;
+        *x = cache ^ old_tags ^ (now_tags << move_bits);
+    } else if constexpr(counter_type == FastSync) {
+        cache &= ~(CellMask << move_bits);
+        cache |= now_tags << move_bits;
+        *x = cache;
+
+        x = (__m256i*)(counters + first_bucket_pos + half);
+        cache = *x;
+        cache &= mask;
+        __m256i cnts = _mm256_srlv_epi64(cache, move_bits) & CellMask;
+        min_cnt = std::min(min_cnt, reduceMinSmallEpu64(cnts));
+        __m256i is_full = _mm256_cmpeq_epi64(cnts, full_cnts);
+        __m256i new_cnts = _mm256_add_epi64(cnts, _mm256_andnot_si256(is_full, ones));
+        *x = cache ^ _mm256_sllv_epi64(cnts ^ new_cnts, move_bits);
+    } else {
+        __m256i old_tags = cache & (CellMask << move_bits);
+        __m256i no_header = _mm256_cmpeq_epi64(old_tags, zeros);
+        *x = cache ^ old_tags ^ (now_tags << move_bits);
+
+        x = (__m256i*)(counters + first_bucket_pos + half);
+        cache = *x;
+        cache &= mask;
+        __m256i cnts = _mm256_srlv_epi64(cache, move_bits) & CellMask;
+        __m256i real_cnts = _mm256_andnot_si256(no_header, _mm256_add_epi64(cnts, ones));
+        min_cnt = std::min(min_cnt, reduceMinSmallEpu64(real_cnts));
+        __m256i is_full = _mm256_cmpeq_epi64(cnts, full_cnts);
+        __m256i new_cnts = _mm256_blendv_epi8(real_cnts, full_cnts, is_full);
+        *x = cache ^ _mm256_sllv_epi64(cnts ^ new_cnts, move_bits);
+    }
+
+    } // end of loop
+    #undef _bits
+    #undef _now_tag
+    #undef _tag_idx
+    #undef _msk
+    #undef _generate_vector
+    return min_cnt;
+}
+#endif // HYPERBF_SIMD_DISPATCH
+
+template <size_t CellBits, CounterType counterType, typename Key>
+bool HyperBloomFilter<CellBits, counterType, Key>::insert(const Key& key, double time) {
     return insert_cnt(key, time) == 0;
 }
 
+template <size_t CellBits, CounterType counterType, typename Key>
+bool HyperBloomFilter<CellBits, counterType, Key>::insert_ticks(const Key& key, uint64_t tick) {
+    return insert_cnt_ticks(key, tick) == 0;
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+void HyperBloomFilter<CellBits, counterType, Key>::merge(
+    const HyperBloomFilter& other, double time
+) {
+    if (other.bucket_num != bucket_num || other.time_threshold != time_threshold
+        || !std::equal(seeds, seeds + TableNum + 1, other.seeds))
+        throw std::invalid_argument("HyperBloomFilter: merging filters of different shapes");
+    for (uint32_t bucket_pos = 0; bucket_pos < bucket_num; ++bucket_pos) {
+        int i = bucket_pos % TableNum;
+        int now_tag = int(time / time_threshold + 1.0 * i / TableNum) % 3 + 1;
+        int prev_tag = (now_tag + 1) % 3 + 1;
+        // 2 = current phase, 1 = previous phase, 0 = empty or banned
+        auto rank = [&](uint64_t tag) { return tag == now_tag ? 2 : tag == prev_tag; };
+        uint64_t bucket = 0, counter = 0;
+        for (size_t cell_pos = 0; cell_pos < CellPerBucket; ++cell_pos) {
+            auto move_bits = CellBits * cell_pos;
+            uint64_t tag_a = (buckets[bucket_pos] >> move_bits) & CellMask;
+            uint64_t tag_b = (other.buckets[bucket_pos] >> move_bits) & CellMask;
+            int rank_a = rank(tag_a), rank_b = rank(tag_b);
+            if (rank_a == 0 && rank_b == 0)
+                continue;
+            bucket |= (rank_a >= rank_b ? tag_a : tag_b) << move_bits;
+            if constexpr(use_counter) {
+                uint64_t cnt_a = (counters[bucket_pos] >> move_bits) & CellMask;
+                uint64_t cnt_b = (other.counters[bucket_pos] >> move_bits) & CellMask;
+                uint64_t cnt;
+                if (rank_a != rank_b)
+                    cnt = rank_a > rank_b ? cnt_a : cnt_b;
+                else if constexpr(counter_type == SyncWithBucket)
+                    cnt = cnt_a + cnt_b + 1; // both headers are items
+                else
+                    cnt = cnt_a + cnt_b;
+                counter |= std::min(cnt, CellMask) << move_bits;
+            }
+        }
+        buckets[bucket_pos] = bucket;
+        if constexpr(use_counter)
+            counters[bucket_pos] = counter;
+    }
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+template <bool Ticks, typename Time>
+void HyperBloomFilter<CellBits, counterType, Key>::insert_cnt_batch(
+    const Key* keys, const Time* times, size_t n, int* cnts
+) {
+    // ring of hashed keys and group positions for the items already being prefetched
+    uint32_t hkeys[PrefetchDistance], group_pos[PrefetchDistance];
+    size_t head = std::min(n, PrefetchDistance);
+    for (size_t i = 0; i < head; ++i) {
+        hkeys[i] = HashKey(keys[i]);
+        group_pos[i] = CalculateGroupPos(hkeys[i]);
+        PrefetchGroup(group_pos[i]);
+    }
+    for (size_t i = 0; i < n; ++i) {
+        uint32_t hkey = hkeys[i % PrefetchDistance];
+        uint32_t pos = group_pos[i % PrefetchDistance];
+        if (i + PrefetchDistance < n) {
+            uint32_t next_hkey = HashKey(keys[i + PrefetchDistance]);
+            uint32_t next_pos = CalculateGroupPos(next_hkey);
+            hkeys[i % PrefetchDistance] = next_hkey;
+            group_pos[i % PrefetchDistance] = next_pos;
+            PrefetchGroup(next_pos);
+        }
+        if constexpr(Ticks) {
+            UpdateTickPhase(times[i]);
+            cnts[i] = insert_cnt_at<true>(hkey, 0, pos);
+        } else {
+            cnts[i] = insert_cnt_at(hkey, times[i], pos);
+        }
+    }
+}
+
+template <size_t CellBits, CounterType counterType, typename Key>
+template <bool Ticks, typename Time>
+void HyperBloomFilter<CellBits, counterType, Key>::insert_batch(
+    const Key* keys, const Time* times, size_t n, bool* is_new
+) {
+    constexpr size_t ChunkSize = 256;
+    int cnts[ChunkSize];
+    for (size_t i = 0; i < n; i += ChunkSize) {
+        size_t len = std::min(n - i, ChunkSize);
+        insert_cnt_batch<Ticks>(keys + i, times + i, len, cnts);
+        for (size_t j = 0; j < len; ++j)
+            is_new[i + j] = cnts[j] == 0;
+    }
+}
+
 } // namespace HyperBF
 
 #include "HyperBloomFilterTest.h"
@@ -4,6 +4,8 @@
 #include <random>
 #include <algorithm>
 
+#include "../lib/FastRange.h"
+
 namespace HyperBF {
 
 // Test mode HBF mimics the behavior of the original HBF,
@@ -23,7 +25,7 @@ public:
     uint64_t* counters;
     double time_threshold;
     uint32_t bucket_num;
-    uint32_t seeds[TableNum + 1];
+    uint64_t seeds[TableNum + 1];
     static constexpr size_t MaxReportSize = _MaxReportSize;
 
     TestModeHyperBF(uint32_t memory, double time_threshold, int seed = 123) :
@@ -32,9 +34,9 @@ public:
         bucket_num -= bucket_num % TableNum;
         buckets = new (align_val_t { 64 }) uint64_t[bucket_num * CellPerBucket] {};
         counters = new (align_val_t { 64 }) uint64_t[bucket_num * CellPerBucket] {};
-        mt19937 rng(seed);
+        mt19937_64 rng(seed);
         for (int i = 0; i <= TableNum; ++i) {
-            seeds[i] = rng();
+            seeds[i] = randomOddSeed(rng);
         }
         if (memory >= 1024)
             printf("Memory = %.1f KB\t (Memory used in HyperBF)\n", memory / 1000.0);
@@ -50,7 +52,7 @@ public:
 
     template <bool CM2Count = false>
     int insert_cnt(int key, double time) {
-        int first_bucket_pos = CalculatePos(key, TableNum) % bucket_num & ~(TableNum - 1);
+        int first_bucket_pos = fastRange(CalculatePos(key, TableNum), bucket_num / TableNum) * TableNum;
         int min_cnt = MaxReportSize;
         vector<int> cnts;
         for (int i = 0; i < TableNum; ++i) {
@@ -100,7 +102,7 @@ public:
 
 private:
     inline uint32_t CalculatePos(uint32_t key, int i) {
-        return (key * seeds[i]) >> 15;
+        return multiplyShift(key, seeds[i]);
     }
 };
 
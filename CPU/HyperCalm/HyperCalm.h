@@ -3,14 +3,29 @@
 
 #include "CalmSpaceSaving.h"
 #include "HyperBloomFilter.h"
+#include "Snapshot.h"
 
+// CellBits of HyperBF bounds the batch size threshold of insert_filter,
+// @see HyperBloomFilter::MaxReportSize
+// Keys of any type with a KeyHash can be used, @see KeyHash
+template <size_t CellBits = 2, typename Key = uint32_t>
 class HyperCalm {
 private:
-    using HBF = HyperBloomFilter<>;
-    CalmSpaceSaving css;
+    using HBF = HyperBloomFilter<CellBits, HyperBF::SyncWithBucket, Key>;
+    CalmSpaceSaving<Key> css;
     HBF hbf;
+    const bool deferred;
 
-    inline int suggestHBFMemory(int memory, double time_threshold) {
+    void css_insert(const Key& key, double time, bool bf_new) {
+        if (deferred)
+            css.insert_deferred(key, time, bf_new);
+        else
+            css.insert(key, time, bf_new);
+    }
+
+public:
+    /// @brief the memory given to HyperBF out of the total memory.
+    static int suggestHBFMemory(int memory, double time_threshold) {
         int suggest_max;
         if (time_threshold > 0.001) {
             suggest_max = 50000;
@@ -20,36 +35,108 @@ private:
         return min(memory / 2, suggest_max);
     }
 
-public:
 #define hbfmem suggestHBFMemory(memory, time_threshold)
 #define sz max(1, memory / 1000)
-    HyperCalm(double time_threshold, double unit_time, int memory, int seed)
-        : css(time_threshold, unit_time, memory - hbfmem, 3, sz, sz),
-          hbf(hbfmem, time_threshold, seed) {}
+    /// @param pending_size slots of the last-seen cache that lets insert skip
+    ///        CalmSS for in-batch items, 0 to update CalmSS on every item,
+    ///        @see CalmSpaceSaving::insert_deferred
+    HyperCalm(double time_threshold, double unit_time, int memory, int seed, int pending_size = 0)
+        : css(time_threshold, unit_time, memory - hbfmem, 3, sz, sz, pending_size),
+          hbf(hbfmem, time_threshold, seed), deferred(pending_size > 0) {}
 #undef sz
 #undef hbfmem
-    void insert(int key, double time) {
-        bool b = hbf.insert(key, time);
-        css.insert(key, time, b);
+    void insert(const Key& key, double time) {
+        css_insert(key, time, hbf.insert(key, time));
+    }
+
+    /// @brief insert a run of count items of key, the first at first_time and
+    ///        the others at last_time, with two updates instead of count.
+    /// @details HyperBF counts every item of the run, as if the others were
+    ///          inserted one by one at last_time. CalmSS only sees the first
+    ///          and the last item, which is all it needs to find the batch
+    ///          starts of a run lying in one batch, but the run takes two
+    ///          TimeRecorder slots instead of count.
+    void insert_weighted(const Key& key, double first_time, double last_time, int count) {
+        if (count <= 0)
+            return;
+        insert(key, first_time);
+        if (count > 1)
+            css_insert(key, last_time, hbf.insert_cnt(key, last_time, count - 1) == 0);
     }
 
-    void insert_filter(int key, double time, size_t min_size) {
+    /// @brief insert, passing to CalmSS only the items of batches of at least min_size.
+    /// @details goes through the last-seen cache as insert does, so both can
+    ///          be mixed on one instance.
+    void insert_filter(const Key& key, double time, size_t min_size) {
         int size = hbf.insert_cnt(key, time) + 1;
         if (size >= min_size)
-            css.insert(key, time, size == min_size);
+            css_insert(key, time, size == min_size);
     }
 
     template <size_t min_size>
-    void insert_filter(int key, double time) {
+    void insert_filter(const Key& key, double time) {
         static_assert(min_size <= HBF::MaxReportSize);
         int size = hbf.insert_cnt(key, time) + 1;
         if (size >= min_size)
-            css.insert(key, time, size == min_size);
+            css_insert(key, time, size == min_size);
     }
 
-    vector<pair<pair<int, int16_t>, int>> get_top_k(int k) const {
+    TopKList<Key> get_top_k(int k) const {
         return css.get_top_k(k);
     }
+
+    /// @brief write the top k pairs into out without allocating, @see CalmSpaceSaving::top_k.
+    template <typename OutputIt>
+    OutputIt top_k(OutputIt out, int k) const {
+        return css.top_k(out, k);
+    }
+
+    /// @brief write the pairs of frequency >= threshold into out, @see CalmSpaceSaving::top_k_above.
+    template <typename OutputIt>
+    OutputIt top_k_above(OutputIt out, int threshold, int limit = INT_MAX) const {
+        return css.top_k_above(out, threshold, limit);
+    }
+
+    /// @brief a ring size for a feed subscribed at threshold, @see ChangeFeed::suggest_capacity.
+    size_t suggest_feed_capacity(uint32_t threshold) const {
+        return ChangeFeed<Key>::suggest_capacity(css.ss_capacity(), threshold);
+    }
+
+    /// @brief publish the changes of the pairs counted at least threshold, @see CalmSpaceSaving::subscribe.
+    void subscribe(ChangeFeed<Key>* feed, uint32_t threshold = 1) {
+        css.subscribe(feed, threshold);
+    }
+
+    /// @brief the periodic batches found so far, to be merged with other nodes' summaries.
+    CalmSummary<Key> summary() const {
+        return css.summary();
+    }
+
+    /// @brief write the whole state into a versioned flat file.
+    void save(const string& path) const {
+        Snapshot::Writer w(path);
+        w.write(uint32_t(CellBits));
+        css.save(w);
+        hbf.save(w);
+        w.close();
+    }
+
+    /// @brief restore a file written by save from a HyperCalm built with the same parameters.
+    /// @details the file is memory-mapped, the nodes of SS and the LRU queue
+    ///          and the entries of the hash tables are decoded one at a time,
+    ///          their links checked as indices, and the count index of the
+    ///          LRU queue is rebuilt from the decoded counts.
+    void load(const string& path) {
+        Snapshot::Reader r(path);
+        r.expect(uint32_t(CellBits), "cell bits");
+        css.load(r);
+        hbf.load(r);
+    }
+
+    /// @brief OR-merge the HyperBF of a node built with the same parameters and seed.
+    void merge_filter(const HyperCalm& other, double time) {
+        hbf.merge(other.hbf, time);
+    }
 };
 
 #endif  // _HYPERCALM_H_
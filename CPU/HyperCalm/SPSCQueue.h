@@ -0,0 +1,88 @@
+#ifndef _SPSCQUEUE_H_
+#define _SPSCQUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+// A bounded lock-free queue for one producer thread and one consumer thread.
+// The capacity, Capacity unless given at construction, is rounded up to a
+// power of 2. The consumer reads a run of items in place and releases them
+// after processing, so that an empty queue also means all pushed items have
+// been processed.
+template <typename T, size_t Capacity = 4096>
+class SPSCQueue {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of 2");
+    static constexpr size_t CacheLine = 64;
+
+    static size_t round_up(size_t n) {
+        size_t res = 1;
+        while (res < n)
+            res <<= 1;
+        return res;
+    }
+
+    const size_t mask;
+    std::unique_ptr<T[]> items;
+    // written by the consumer
+    alignas(CacheLine) std::atomic<size_t> head { 0 };
+    size_t cached_tail = 0;
+    // written by the producer
+    alignas(CacheLine) std::atomic<size_t> tail { 0 };
+    size_t cached_head = 0;
+
+public:
+    explicit SPSCQueue(size_t capacity = Capacity)
+        : mask(round_up(capacity) - 1), items(new T[mask + 1]) {}
+
+    size_t capacity() const {
+        return mask + 1;
+    }
+
+    /// @brief push an item, spin while the queue is full. Producer only.
+    void push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == capacity()) {
+            while ((cached_head = head.load(std::memory_order_acquire)) + capacity() == t)
+                std::this_thread::yield();
+        }
+        items[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+    }
+
+    /// @brief push an item, false if the queue is full. Producer only.
+    bool try_push(const T& item) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head == capacity()) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head == capacity())
+                return false;
+        }
+        items[t & mask] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// @brief process all pushed items by f, return the number processed. Consumer only.
+    template <typename Func>
+    size_t consume(Func&& f) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail)
+                return 0;
+        }
+        for (size_t i = h; i != cached_tail; ++i)
+            f(items[i & mask]);
+        head.store(cached_tail, std::memory_order_release);
+        return cached_tail - h;
+    }
+
+    /// @brief whether all pushed items have been processed.
+    bool empty() const {
+        return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire);
+    }
+};
+
+#endif // _SPSCQUEUE_H_
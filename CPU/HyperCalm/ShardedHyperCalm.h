@@ -0,0 +1,116 @@
+#ifndef _SHARDEDHYPERCALM_H_
+#define _SHARDEDHYPERCALM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "HyperCalm.h"
+#include "SPSCQueue.h"
+
+// ShardedHyperCalm routes each key by hash to one of several HyperCalm
+// instances, each owned by its own worker thread and fed through an SPSC
+// queue. The memory budget is split evenly between the shards. Every key
+// lives in exactly one shard, so a shard sees all items of its keys in order,
+// and merging the shard-local top-k lists keeps the semantics of HyperCalm.
+//
+// insert is called from a single producer thread.
+template <size_t CellBits = 2, typename Key = uint32_t>
+class ShardedHyperCalm {
+private:
+    using Shard = HyperCalm<CellBits, Key>;
+    using TopK = TopKList<Key>;
+
+    struct Item {
+        Key key;
+        float time;
+    };
+
+    struct Worker {
+        unique_ptr<Shard> shard;
+        SPSCQueue<Item> queue;
+        thread runner;
+    };
+
+    vector<unique_ptr<Worker>> workers;
+    atomic<bool> stopped { false };
+
+    // independent of the multiplicative hashes inside HyperBF
+    static inline uint32_t ShardHash(const Key& raw_key) {
+        uint32_t key = KeyHash<Key>()(raw_key);
+        key ^= key >> 16;
+        key *= 0x85ebca6b;
+        key ^= key >> 13;
+        key *= 0xc2b2ae35;
+        key ^= key >> 16;
+        return key;
+    }
+
+    void run(Worker& w) {
+        auto insert = [&](const Item& item) { w.shard->insert(item.key, item.time); };
+        while (true) {
+            if (w.queue.consume(insert))
+                continue;
+            if (stopped.load(memory_order_acquire)) {
+                w.queue.consume(insert);
+                return;
+            }
+            this_thread::yield();
+        }
+    }
+
+public:
+    ShardedHyperCalm(double time_threshold, double unit_time, int memory, int seed, int shard_num) {
+        shard_num = max(shard_num, 1);
+        for (int i = 0; i < shard_num; ++i) {
+            auto w = make_unique<Worker>();
+            w->shard = make_unique<Shard>(time_threshold, unit_time, memory / shard_num, seed + i);
+            workers.push_back(move(w));
+        }
+        printf("Shards = %d\t (Number of HyperCalm shards)\n", shard_num);
+        for (auto& w : workers)
+            w->runner = thread(&ShardedHyperCalm::run, this, ref(*w));
+    }
+
+    ~ShardedHyperCalm() {
+        stopped.store(true, memory_order_release);
+        for (auto& w : workers)
+            w->runner.join();
+    }
+
+    void insert(const Key& key, double time) {
+        size_t i = ShardHash(key) % workers.size();
+        workers[i]->queue.push({ key, float(time) });
+    }
+
+    /// @brief wait until the shards have processed all inserted items.
+    void flush() {
+        for (auto& w : workers)
+            while (!w->queue.empty())
+                this_thread::yield();
+    }
+
+    /// @brief merge the top-k lists of the shards, after all items are processed.
+    TopK get_top_k(int k) {
+        flush();
+        TopK ans;
+        for (auto& w : workers) {
+            for (auto& entry : w->shard->get_top_k(k)) {
+                if (entry.second > 0)
+                    ans.push_back(entry);
+            }
+        }
+        auto by_count = [](const auto& a, const auto& b) { return a.second > b.second; };
+        if (ans.size() > k) {
+            nth_element(ans.begin(), ans.begin() + k, ans.end(), by_count);
+            ans.resize(k);
+        }
+        sort(ans.begin(), ans.end(), by_count);
+        ans.resize(k);
+        return ans;
+    }
+};
+
+#endif // _SHARDEDHYPERCALM_H_
@@ -0,0 +1,115 @@
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// A snapshot is a flat file of fixed-size fields and arrays in host byte
+// order, written sequentially and read back in the same order. The reader
+// maps the whole file, so arrays are copied straight out of the page cache.
+namespace Snapshot {
+
+static constexpr char kMagic[8] = { 'H', 'Y', 'P', 'C', 'A', 'L', 'M', 0 };
+static constexpr uint32_t kVersion = 8;
+
+class Writer {
+    FILE* pf;
+
+public:
+    explicit Writer(const std::string& path) : pf(fopen(path.c_str(), "wb")) {
+        if (!pf)
+            throw std::runtime_error("Snapshot: cannot open " + path);
+        write_array(kMagic, sizeof(kMagic));
+        write(kVersion);
+    }
+    ~Writer() {
+        if (pf)
+            fclose(pf);
+    }
+
+    template <typename T>
+    void write(const T& value) {
+        write_array(&value, 1);
+    }
+
+    template <typename T>
+    void write_array(const T* values, size_t n) {
+        if (n && fwrite(values, sizeof(T), n, pf) != n)
+            throw std::runtime_error("Snapshot: write failed");
+    }
+
+    /// @brief flush and close the file, reporting errors that a destructor cannot.
+    void close() {
+        int ret = fclose(pf);
+        pf = nullptr;
+        if (ret != 0)
+            throw std::runtime_error("Snapshot: close failed");
+    }
+};
+
+class Reader {
+    const char* data = nullptr;
+    size_t size = 0, offset = 0;
+
+public:
+    explicit Reader(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error("Snapshot: cannot open " + path);
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            size = st.st_size;
+            void* addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+            if (addr != MAP_FAILED)
+                data = (const char*)addr;
+        }
+        ::close(fd);
+        if (!data)
+            throw std::runtime_error("Snapshot: cannot map " + path);
+        char magic[sizeof(kMagic)];
+        read_array(magic, sizeof(magic));
+        if (memcmp(magic, kMagic, sizeof(kMagic)) != 0)
+            throw std::invalid_argument("Snapshot: not a HyperCalm snapshot");
+        if (read<uint32_t>() != kVersion)
+            throw std::invalid_argument("Snapshot: unsupported version");
+    }
+    ~Reader() {
+        munmap((void*)data, size);
+    }
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    template <typename T>
+    T read() {
+        T value;
+        read_array(&value, 1);
+        return value;
+    }
+
+    template <typename T>
+    void read_array(T* values, size_t n) {
+        if ((size - offset) / sizeof(T) < n)
+            throw std::invalid_argument("Snapshot: truncated file");
+        memcpy((void*)values, data + offset, n * sizeof(T));
+        offset += n * sizeof(T);
+    }
+
+    /// @brief read a value and check that it equals the expected one.
+    template <typename T>
+    void expect(const T& expected, const char* what) {
+        if (read<T>() != expected)
+            throw std::invalid_argument(std::string("Snapshot: mismatched ") + what);
+    }
+};
+
+} // namespace Snapshot
+
+#endif // _SNAPSHOT_H_
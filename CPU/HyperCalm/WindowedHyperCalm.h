@@ -0,0 +1,106 @@
+#ifndef _WINDOWEDHYPERCALM_H_
+#define _WINDOWEDHYPERCALM_H_
+
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#include "HyperCalm.h"
+
+// WindowedHyperCalm reports the periodic batches of a sliding window of
+// time instead of the whole stream, so periods that stopped age out.
+//
+// The window is cut into epoch_num epochs. One CalmSpaceSaving behind one
+// HyperBF counts the current epoch, sized from the whole memory as in
+// HyperCalm. When time passes into a new epoch, the counts of SS and the
+// LRU queue are exported as a CalmSummary and cleared, and the summary of
+// the oldest epoch is dropped. The TimeRecorder is kept, so the first
+// period of a key in an epoch is counted from its last batch in the one
+// before. A query merges the current counts with the summaries of the last
+// epoch_num - 1 epochs, so it covers between (epoch_num - 1) / epoch_num of
+// the window and the whole window. Counting stays as cheap as in HyperCalm,
+// and old counts leave a whole epoch at a time, with no sweep or decay on
+// the insert path.
+//
+// A past epoch keeps only its largest entries, the others left under its
+// min_count, so that all of them hold as many entries as SS has counters.
+// They are paid for out of the memory of CalmSS.
+template <size_t CellBits = 2, typename Key = uint32_t>
+class WindowedHyperCalm {
+private:
+    using HBF = HyperBloomFilter<CellBits, HyperBF::SyncWithBucket, Key>;
+    using CSS = CalmSpaceSaving<Key>;
+    using Summary = CalmSummary<Key>;
+
+    // the past epochs together keep as many entries as SS has counters
+    static int kept_entries(int counters, int epoch_num) {
+        return epoch_num > 1 ? (counters + epoch_num - 2) / (epoch_num - 1) : 0;
+    }
+
+    static int css_memory(int memory, int hbf_memory, int sz, int epoch_num) {
+        return largest_fitting(memory - hbf_memory, [&](int m) {
+            int keep = kept_entries(CSS::counters_for(m, 3, sz, sz), epoch_num);
+            return int64_t(m) + int64_t(epoch_num - 1) * keep * int64_t(sizeof(typename Summary::Entry));
+        });
+    }
+
+    CSS css;
+    HBF hbf;
+    deque<Summary> past; // the summaries of the last epoch_num - 1 epochs, oldest first
+    const int epoch_num;
+    const int keep; // the entries kept of a past epoch
+    const double epoch_time;
+    int64_t epoch = -1; // the epoch counted by css
+
+    void rotate(double time) {
+        int64_t e = int64_t(floor(time / epoch_time));
+        if (epoch < 0)
+            epoch = e;
+        if (e <= epoch)
+            return;
+        // the epochs that passed without items leave empty summaries
+        int64_t passed = min(e - epoch, int64_t(epoch_num));
+        // the largest entries of the epoch, the others under its min_count
+        past.push_back(Summary::merge({ css.summary() }, keep));
+        for (int64_t i = 1; i < passed; ++i)
+            past.push_back(Summary { past.back().capacity });
+        while (past.size() > size_t(epoch_num - 1))
+            past.pop_front();
+        css.clear_counters();
+        epoch = e;
+    }
+
+public:
+#define hbfmem HyperCalm<CellBits, Key>::suggestHBFMemory(memory, time_threshold)
+#define sz max(1, memory / 1000)
+    /// @param window the length of time reported, in the unit of item times
+    /// @param epoch_num the number of epochs the window is cut into
+    WindowedHyperCalm(double time_threshold, double unit_time, int memory, int seed,
+        double window, int epoch_num = 4)
+        : css(time_threshold, unit_time, css_memory(memory, hbfmem, sz, max(epoch_num, 1)), 3, sz, sz),
+          hbf(hbfmem, time_threshold, seed), epoch_num(max(epoch_num, 1)),
+          keep(kept_entries(css.ss_capacity(), this->epoch_num)),
+          epoch_time(window / max(epoch_num, 1)) {
+        printf("Epochs = %d\t (Number of epochs in the window)\n", this->epoch_num);
+    }
+#undef sz
+#undef hbfmem
+
+    void insert(const Key& key, double time) {
+        rotate(time);
+        css.insert(key, time, hbf.insert(key, time));
+    }
+
+    /// @brief the periodic batches of the window, merged from all epochs.
+    CalmSummary<Key> summary() const {
+        vector<Summary> summaries(past.begin(), past.end());
+        summaries.push_back(css.summary());
+        return Summary::merge(summaries, summaries.back().capacity);
+    }
+
+    TopKList<Key> get_top_k(int k) const {
+        return summary().get_top_k(k);
+    }
+};
+
+#endif // _WINDOWEDHYPERCALM_H_
@@ -7,10 +7,16 @@ extern void ParseArgs(int argc, char** argv);
 extern vector<pair<uint32_t, float>> load_data(const string& fileName);
 
 extern void periodic_test(const vector<pair<uint32_t, float>>& input);
+extern void periodic_stream_test();
 
 int main(int argc, char** argv) {
 	ParseArgs(argc, argv);
 	printf("---------------------------------------------\n");
+	if (stream) {
+		periodic_stream_test();
+		printf("---------------------------------------------\n");
+		return 0;
+	}
 	auto input = load_data(fileName);
 	printf("---------------------------------------------\n");
 	periodic_test(input);
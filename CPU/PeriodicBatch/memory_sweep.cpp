@@ -0,0 +1,105 @@
+#include <cstdio>
+#include <ctime>
+
+#include "params.h"
+
+using namespace std;
+
+#include "../ComparedAlgorithms/ClockUSS.h"
+#include "../HyperCalm/HyperCalm.h"
+#include "../ComparedAlgorithms/groundtruth.h"
+
+using namespace groundtruth::type_info;
+
+template <typename Sketch>
+tuple<int, long long, double> single_test(
+    Sketch&& sketch,
+    const vector<Record>& input,
+    const vector<pair<PeriodicKey, int>>& ans
+) {
+    int corret_count = 0;
+    long long sae = 0;
+    double sre = 0;
+    for (auto &[tkey, ttime] : input) {
+        sketch.insert(tkey, ttime);
+    }
+    vector<pair<PeriodicKey, int>> our = sketch.get_top_k(TOPK_THRESHOLD);
+    sort(our.begin(), our.end());
+    int j = 0;
+    for (auto &[key, freq] : our) {
+        while (j + 1 < ans.size() && ans[j].first < key)
+            ++j;
+        if (j < ans.size() && ans[j].first == key) {
+            ++corret_count;
+            auto diff = abs(ans[j].second - freq);
+            sae += diff;
+            sre += diff / double(ans[j].second);
+        }
+    }
+    return {corret_count, sae, sre};
+}
+
+// Runs the sketch with memory doubled from -m up to -M. The LRU queue of
+// CalmSS grows with the memory, so the large sizes show the cost of picking
+// the LRU slot to replace.
+void memory_sweep(const vector<Record>& input) {
+    groundtruth::adjust_params(input, BATCH_TIME, UNIT_TIME);
+    groundtruth::item_count(input);
+    auto batches = groundtruth::batch(input, BATCH_TIME, BATCH_SIZE_LIMIT).first;
+    auto ans = groundtruth::topk(input, batches, UNIT_TIME, TOPK_THRESHOLD);
+    sort(ans.begin(), ans.end());
+    printf("BATCH_TIME = %f, UNIT_TIME = %f, Top K: %d\n", BATCH_TIME, UNIT_TIME, TOPK_THRESHOLD);
+    printf("---------------------------------------------\n");
+    printName(sketchName);
+    vector<int> memories = { memory };
+    while (int64_t(memories.back()) * 2 <= max_memory)
+        memories.push_back(memories.back() * 2);
+    printf("Memory sweep from %d B to %d B\n", memories.front(), memories.back());
+    vector<tuple<int, double, double, double, double>> rows;
+    for (int mem : memories) {
+        printf("---------------------------------------------\n");
+        int corret_count = 0;
+        double sae = 0, sre = 0;
+        uint64_t time_ns = 0;
+        for (int t = 0; t < repeat_time; ++t) {
+            timespec start_time, end_time;
+            clock_gettime(CLOCK_MONOTONIC, &start_time);
+            tuple<int, long long, double> res;
+            if (sketchName == 1)
+                res = single_test(HyperCalm(BATCH_TIME, UNIT_TIME, mem, t, pending_size), input, ans);
+            else
+                res = single_test(ClockUSS(BATCH_TIME, UNIT_TIME, mem, t), input, ans);
+            clock_gettime(CLOCK_MONOTONIC, &end_time);
+            time_ns += (end_time.tv_sec - start_time.tv_sec) * uint64_t(1e9);
+            time_ns += (end_time.tv_nsec - start_time.tv_nsec);
+            corret_count += get<0>(res);
+            sae += get<1>(res);
+            sre += get<2>(res);
+        }
+        double recall = 1.0 * corret_count / ans.size() / repeat_time;
+        double aae = corret_count ? sae / corret_count : 0.;
+        double are = corret_count ? sre / corret_count : 0.;
+        rows.emplace_back(mem, recall, aae, are, 1e3 * input.size() * repeat_time / time_ns);
+    }
+    printf("---------------------------------------------\n");
+    printf("Results:\n");
+    printf("Memory (B)\t Recall\t\t AAE\t\t ARE\t\t Speed (M/s)\n");
+    for (auto [mem, recall, aae, are, speed] : rows)
+        printf("%d\t %f\t %f\t %f\t %f\n", mem, recall, aae, are, speed);
+}
+
+extern void ParseArgs(int argc, char** argv);
+extern vector<Record> load_data(const string& fileName);
+
+int main(int argc, char** argv) {
+    ParseArgs(argc, argv);
+    if (sketchName > 2) {
+        printf("memory_sweep supports -s 1 and 2\n");
+        return 0;
+    }
+    printf("---------------------------------------------\n");
+    auto input = load_data(fileName);
+    printf("---------------------------------------------\n");
+    memory_sweep(input);
+    printf("---------------------------------------------\n");
+}
@@ -3,17 +3,29 @@
 
 #include <string>
 
-inline std::string fileName;
+inline std::string fileName, snapshotName;
 inline int sketchName;
 inline double BATCH_TIME, UNIT_TIME;
 inline bool verbose = false;
 inline int repeat_time = 1, TOPK_THRESHOLD = 200, BATCH_SIZE_LIMIT = 1, memory = 5e5;
+inline int thread_num = 0; // shards of sharded HyperCalm, 0 for all cores
+inline int max_memory = 0; // largest memory of memory_sweep, doubled from memory
+inline int pending_size = 0; // slots of the last-seen cache of HyperCalm, 0 for none
+inline double window = 0; // window of windowed HyperCalm, 0 for twice the trace span
+inline bool aggregate = false; // feed HyperCalm runs of a key through insert_weighted
+inline bool stream = false; // stream the trace in chunks instead of loading it
+inline int feed_threshold = 0; // replay the change feed of HyperCalm from this count, 0 for none
+inline int merge_num = 0; // split the trace across this many HyperCalm and merge them, 0 for none
 
 #include <iostream>
 
 static void printName(int sketchName) {
     if (sketchName == 1) {
         std::cout << "Test HyperCalm\n";
+    } else if (sketchName == 3) {
+        std::cout << "Test HyperCalm (sharded)\n";
+    } else if (sketchName == 4) {
+        std::cout << "Test HyperCalm (windowed)\n";
     } else {
         std::cout << "Test Clock+USS\n";
     }
@@ -19,8 +19,17 @@ void ParseArgs(int argc, char** argv) {
         ("topk,k", value<int>()->required(), "topk")
         ("batch_size,l", value<int>()->required(), "batch size threshold")
         ("memory,m", value<int>()->required(), "memory")
+        ("max_memory,M", value<int>(), "max memory of the memory sweep")
         ("batch_time,b", value<double>()->required(), "batch time")
         ("unit_time,u", value<double>()->required(),"unit time")
+        ("threads,T", value<int>(), "number of shards of sharded HyperCalm")
+        ("snapshot,P", value<string>(), "snapshot file of HyperCalm")
+        ("last_seen,L", value<int>(), "slots of the last-seen cache of HyperCalm")
+        ("window,W", value<double>(), "window of windowed HyperCalm")
+        ("aggregate,A", "insert runs of a key into HyperCalm with insert_weighted")
+        ("stream,R", "stream the trace in chunks, without the ground truth")
+        ("feed,C", value<int>(), "replay the change feed of HyperCalm from this count")
+        ("merge,N", value<int>(), "split the trace across N HyperCalm and merge them")
         ("verbose,V", "show verbose output");
     variables_map vm;
 
@@ -33,8 +42,8 @@ void ParseArgs(int argc, char** argv) {
     }
     if (vm.count("sketchName")) {
         sketchName = vm["sketchName"].as<int>();
-        if (sketchName < 1 || sketchName > 2) {
-            printf("sketchName < 1 || sketchName > 2\n");
+        if (sketchName < 1 || sketchName > 4) {
+            printf("sketchName < 1 || sketchName > 4\n");
             exit(0);
         }
     } else {
@@ -49,10 +58,28 @@ void ParseArgs(int argc, char** argv) {
         BATCH_SIZE_LIMIT = vm["batch_size"].as<int>();
     if (vm.count("memory"))
         memory = vm["memory"].as<int>();
+    if (vm.count("max_memory"))
+        max_memory = vm["max_memory"].as<int>();
     if (vm.count("batch_time"))
         BATCH_TIME = vm["batch_time"].as<double>();
     if (vm.count("unit_time"))
         UNIT_TIME = vm["unit_time"].as<double>();
+    if (vm.count("threads"))
+        thread_num = vm["threads"].as<int>();
+    if (vm.count("snapshot"))
+        snapshotName = vm["snapshot"].as<string>();
+    if (vm.count("last_seen"))
+        pending_size = vm["last_seen"].as<int>();
+    if (vm.count("window"))
+        window = vm["window"].as<double>();
+    if (vm.count("aggregate"))
+        aggregate = true;
+    if (vm.count("stream"))
+        stream = true;
+    if (vm.count("feed"))
+        feed_threshold = vm["feed"].as<int>();
+    if (vm.count("merge"))
+        merge_num = vm["merge"].as<int>();
     if (vm.count("verbose"))
         verbose = true;
 }
@@ -2,6 +2,9 @@
 #include <cassert>
 #include <ctime>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <thread>
 #include <vector>
 
 #include "params.h"
@@ -10,23 +13,21 @@ using namespace std;
 
 #include "../ComparedAlgorithms/ClockUSS.h"
 #include "../HyperCalm/HyperCalm.h"
+#include "../HyperCalm/ShardedHyperCalm.h"
+#include "../HyperCalm/WindowedHyperCalm.h"
 #include "../ComparedAlgorithms/groundtruth.h"
+#include "../datasets/trace_stream.h"
 
 using namespace groundtruth::type_info;
 
-template <typename Sketch>
-tuple<int, long long, double> single_test(
-    Sketch&& sketch,
-    const vector<Record>& input,
+// the correct pairs of a top-k and their absolute and relative errors
+tuple<int, long long, double> score_top_k(
+    vector<pair<PeriodicKey, int>> our,
     const vector<pair<PeriodicKey, int>>& ans
 ) {
     int corret_count = 0;
     long long sae = 0;
     double sre = 0;
-    for (auto &[tkey, ttime] : input) {
-        sketch.insert(tkey, ttime);
-    }
-    vector<pair<PeriodicKey, int>> our = sketch.get_top_k(TOPK_THRESHOLD);
     sort(our.begin(), our.end());
     int j = 0;
     for (auto &[key, freq] : our) {
@@ -42,6 +43,172 @@ tuple<int, long long, double> single_test(
     return {corret_count, sae, sre};
 }
 
+template <typename Sketch>
+tuple<int, long long, double> single_test(
+    Sketch&& sketch,
+    const vector<Record>& input,
+    const vector<pair<PeriodicKey, int>>& ans
+) {
+    for (auto &[tkey, ttime] : input) {
+        sketch.insert(tkey, ttime);
+    }
+    return score_top_k(sketch.get_top_k(TOPK_THRESHOLD), ans);
+}
+
+struct Run {
+    uint32_t key;
+    float first_time, last_time;
+    int count;
+};
+
+// Runs of consecutive items of a key, each within BATCH_TIME of the last,
+// as a collector would aggregate them upstream.
+static vector<Run> aggregate_runs(const vector<Record>& input) {
+    vector<Run> runs;
+    for (auto &[tkey, ttime] : input) {
+        if (!runs.empty() && runs.back().key == tkey && ttime - runs.back().last_time < BATCH_TIME) {
+            runs.back().last_time = ttime;
+            ++runs.back().count;
+        } else {
+            runs.push_back({ tkey, ttime, ttime, 1 });
+        }
+    }
+    return runs;
+}
+
+template <typename Sketch>
+tuple<int, long long, double> run_test(
+    Sketch&& sketch,
+    const vector<Run>& runs,
+    const vector<pair<PeriodicKey, int>>& ans
+) {
+    for (auto& run : runs) {
+        sketch.insert_weighted(run.key, run.first_time, run.last_time, run.count);
+    }
+    // score the top-k as single_test does, with no item left to insert
+    return single_test(sketch, {}, ans);
+}
+
+static double elapsed_ms(const timespec& start_time, const timespec& end_time) {
+    return (end_time.tv_sec - start_time.tv_sec) * 1e3 +
+           (end_time.tv_nsec - start_time.tv_nsec) / 1e6;
+}
+
+// Save HyperCalm after the stream, restore it into a new instance, and check
+// that both report the same top-k.
+void snapshot_test(const vector<Record>& input) {
+    HyperCalm sketch(BATCH_TIME, UNIT_TIME, memory, 0, pending_size);
+    for (auto &[tkey, ttime] : input) {
+        sketch.insert(tkey, ttime);
+    }
+    HyperCalm restored(BATCH_TIME, UNIT_TIME, memory, 0, pending_size);
+    timespec start_time, save_time, load_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    sketch.save(snapshotName);
+    clock_gettime(CLOCK_MONOTONIC, &save_time);
+    restored.load(snapshotName);
+    clock_gettime(CLOCK_MONOTONIC, &load_time);
+    bool same = sketch.get_top_k(TOPK_THRESHOLD) == restored.get_top_k(TOPK_THRESHOLD);
+    cout << "---------------------------------------------" << endl;
+    cout << "Snapshot:\t " << snapshotName << endl;
+    cout << "Save Time:\t " << elapsed_ms(start_time, save_time) << " ms" << endl;
+    cout << "Load Time:\t " << elapsed_ms(save_time, load_time) << " ms" << endl;
+    cout << "Restored Top-K:\t " << (same ? "identical" : "DIFFERENT") << endl;
+}
+
+// Replay the change feed of HyperCalm into a map on a consumer thread while
+// the stream is inserted, and check that the map ends with the pairs that
+// top_k_above lists. Events dropped by a full feed make the replay differ.
+void feed_test(const vector<Record>& input) {
+    using Pair = pair<ReportKey<uint32_t>, int16_t>;
+    HyperCalm sketch(BATCH_TIME, UNIT_TIME, memory, 0, pending_size);
+    ChangeFeed<uint32_t> feed(sketch.suggest_feed_capacity(feed_threshold));
+    sketch.subscribe(&feed, feed_threshold);
+    map<Pair, int> replayed;
+    size_t events = 0;
+    atomic<bool> done { false };
+    auto apply = [&](const ChangeEvent<uint32_t>& event) {
+        Pair pair { event.key, event.delta };
+        if (event.type == ChangeType::Leave)
+            replayed.erase(pair);
+        else
+            replayed[pair] = event.count;
+    };
+    thread consumer([&] {
+        while (!done.load(memory_order_acquire)) {
+            size_t n = feed.drain(apply);
+            events += n;
+            if (!n)
+                this_thread::yield();
+        }
+        events += feed.drain(apply);
+    });
+    for (auto &[tkey, ttime] : input) {
+        sketch.insert(tkey, ttime);
+    }
+    done.store(true, memory_order_release);
+    consumer.join();
+
+    vector<TopKEntry<uint32_t>> listed;
+    sketch.top_k_above(back_inserter(listed), feed_threshold);
+    map<Pair, int> expected;
+    for (auto& [pair, count] : listed)
+        expected[pair] = count;
+    cout << "---------------------------------------------" << endl;
+    cout << "Feed Threshold:\t " << feed_threshold << endl;
+    cout << "Feed Capacity:\t " << feed.capacity() << endl;
+    cout << "Feed Events:\t " << events << endl;
+    cout << "Feed Dropped:\t " << feed.dropped() << endl;
+    // a replay that lost events may still match by luck, it is not agreement
+    const char* verdict = feed.dropped() ? "INCOMPLETE, events dropped, resync from top_k_above"
+        : replayed == expected ? "identical" : "DIFFERENT";
+    cout << "Feed Replay:\t " << verdict
+         << " (" << replayed.size() << " pairs replayed, " << expected.size() << " listed)" << endl;
+}
+
+// Split the trace by time across merge_num HyperCalm, each taking over the
+// HyperBF of the one before with merge_filter, then merge their summaries
+// and score the merged top-k. The same handover of plain HyperBFs is checked
+// to report every item as one HyperBF over the whole trace does. A merge
+// clears the banned cells that an insert clears only in the buckets it
+// touches, so the single HyperBF is merged with an empty one at each handover.
+void merge_test(const vector<Record>& input, const vector<pair<PeriodicKey, int>>& ans) {
+    int hbf_memory = HyperCalm<>::suggestHBFMemory(memory, BATCH_TIME);
+    HyperBloomFilter<> single(hbf_memory, BATCH_TIME, 0), empty(hbf_memory, BATCH_TIME, 0);
+    unique_ptr<HyperCalm<>> prev;
+    unique_ptr<HyperBloomFilter<>> prev_filter;
+    vector<CalmSummary<uint32_t>> summaries;
+    size_t begin = 0, agree = 0;
+    for (int i = 0; i < merge_num; ++i) {
+        size_t end = input.size() * (i + 1) / merge_num;
+        auto node = make_unique<HyperCalm<>>(BATCH_TIME, UNIT_TIME, memory, 0, pending_size);
+        auto filter = make_unique<HyperBloomFilter<>>(hbf_memory, BATCH_TIME, 0);
+        if (prev && begin < end) {
+            node->merge_filter(*prev, input[begin].second);
+            filter->merge(*prev_filter, input[begin].second);
+            single.merge(empty, input[begin].second);
+        }
+        for (size_t j = begin; j < end; ++j) {
+            auto &[tkey, ttime] = input[j];
+            node->insert(tkey, ttime);
+            agree += filter->insert(tkey, ttime) == single.insert(tkey, ttime);
+        }
+        summaries.push_back(node->summary());
+        prev = move(node);
+        prev_filter = move(filter);
+        begin = end;
+    }
+    auto merged = CalmSummary<uint32_t>::merge(summaries, summaries[0].capacity);
+    auto [corret_count, sae, sre] = score_top_k(merged.get_top_k(TOPK_THRESHOLD), ans);
+    cout << "---------------------------------------------" << endl;
+    cout << "Merged Nodes:\t " << merge_num << endl;
+    cout << "Merged Recall:\t " << 1.0 * corret_count / ans.size() << endl;
+    cout << "Merged AAE:\t " << 1.0 * sae / corret_count << endl;
+    cout << "Merged ARE:\t " << sre / corret_count << endl;
+    cout << "Filter Handover: " << (agree == input.size() ? "identical" : "DIFFERENT")
+         << " (" << agree << " of " << input.size() << " items agree)" << endl;
+}
+
 void periodic_test(const vector<pair<uint32_t, float>>& input) {
     groundtruth::adjust_params(input, BATCH_TIME, UNIT_TIME);
     groundtruth::item_count(input);
@@ -54,12 +221,26 @@ void periodic_test(const vector<pair<uint32_t, float>>& input) {
     sort(ans.begin(), ans.end());
     int corret_count = 0;
     double sae = 0, sre = 0;
+    int shard_num = thread_num ? thread_num : max(1u, thread::hardware_concurrency());
+    // by default the window covers the whole trace, to compare with the ground truth
+    double window_time = window > 0 ? window : 2 * (input.back().second - input.front().second);
+    vector<Run> runs;
+    if (aggregate && sketchName == 1) {
+        runs = aggregate_runs(input);
+        printf("Runs: %zu\t (Runs of a key inserted by insert_weighted)\n", runs.size());
+    }
     timespec start_time, end_time;
     clock_gettime(CLOCK_MONOTONIC, &start_time);
     for (int t = 0; t < repeat_time; ++t) {
         tuple<int, long long, double> res;
-        if (sketchName == 1)
-            res = single_test(HyperCalm(BATCH_TIME, UNIT_TIME, memory, t), input, ans);
+        if (sketchName == 1 && aggregate)
+            res = run_test(HyperCalm(BATCH_TIME, UNIT_TIME, memory, t, pending_size), runs, ans);
+        else if (sketchName == 1)
+            res = single_test(HyperCalm(BATCH_TIME, UNIT_TIME, memory, t, pending_size), input, ans);
+        else if (sketchName == 3)
+            res = single_test(ShardedHyperCalm(BATCH_TIME, UNIT_TIME, memory, t, shard_num), input, ans);
+        else if (sketchName == 4)
+            res = single_test(WindowedHyperCalm(BATCH_TIME, UNIT_TIME, memory, t, window_time), input, ans);
         else
             res = single_test(ClockUSS(BATCH_TIME, UNIT_TIME, memory, t), input, ans);
         corret_count += get<0>(res);
@@ -76,4 +257,66 @@ void periodic_test(const vector<pair<uint32_t, float>>& input) {
     cout << "Recall Rate:\t " << 1.0 * corret_count / ans.size() / repeat_time << endl;
     cout << "AAE:\t\t " << sae / corret_count << endl;
     cout << "ARE:\t\t " << sre / corret_count << endl;
+    if (!snapshotName.empty())
+        snapshot_test(input);
+    if (feed_threshold > 0)
+        feed_test(input);
+    if (merge_num > 0)
+        merge_test(input, ans);
+}
+
+template <typename Sketch>
+pair<size_t, vector<pair<PeriodicKey, int>>> stream_single_test(Sketch&& sketch) {
+    TraceStream trace(fileName);
+    size_t n = trace.for_each([&](uint32_t key, float time) { sketch.insert(key, time); });
+    return { n, sketch.get_top_k(TOPK_THRESHOLD) };
+}
+
+// Stream the trace through the sketch in chunks read by another thread, so
+// traces of any length run in constant memory. There is no ground truth, so
+// only the speed and the top-k are reported, and -b and -u must be given.
+void periodic_stream_test() {
+    if (!BATCH_TIME || !UNIT_TIME) {
+        printf("please use -b and -u to give BATCH_TIME and UNIT_TIME when streaming.\n");
+        exit(0);
+    }
+    if (sketchName == 4 && window <= 0) {
+        printf("please use -W to give the window when streaming.\n");
+        exit(0);
+    }
+    printf("Streaming %s\n", fileName.c_str());
+    printf("BATCH_TIME = %f, UNIT_TIME = %f\n", BATCH_TIME, UNIT_TIME);
+    printf("Total Memory: %d B, Top K: %d\n", memory, TOPK_THRESHOLD);
+    cout << "---------------------------------------------" << '\n';
+    printName(sketchName);
+    int shard_num = thread_num ? thread_num : max(1u, thread::hardware_concurrency());
+    size_t items = 0;
+    vector<pair<PeriodicKey, int>> our;
+    timespec start_time, end_time;
+    clock_gettime(CLOCK_MONOTONIC, &start_time);
+    for (int t = 0; t < repeat_time; ++t) {
+        pair<size_t, vector<pair<PeriodicKey, int>>> res;
+        if (sketchName == 1)
+            res = stream_single_test(HyperCalm(BATCH_TIME, UNIT_TIME, memory, t, pending_size));
+        else if (sketchName == 3)
+            res = stream_single_test(ShardedHyperCalm(BATCH_TIME, UNIT_TIME, memory, t, shard_num));
+        else if (sketchName == 4)
+            res = stream_single_test(WindowedHyperCalm(BATCH_TIME, UNIT_TIME, memory, t, window));
+        else
+            res = stream_single_test(ClockUSS(BATCH_TIME, UNIT_TIME, memory, t));
+        items += res.first;
+        our = move(res.second);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end_time);
+    uint64_t time_ns =
+        uint64_t(end_time.tv_sec - start_time.tv_sec) * 1000000000 +
+        (end_time.tv_nsec - start_time.tv_nsec);
+    int reported = count_if(our.begin(), our.end(), [](auto& entry) { return entry.second > 0; });
+    cout << "---------------------------------------------" << endl;
+    cout << "Results:" << endl;
+    cout << "items:\t\t " << items / repeat_time << endl;
+    cout << "Average Speed:\t " << 1e3 * items / time_ns << " M/s" << endl;
+    cout << "Reported Pairs:\t " << reported << endl;
+    if (reported)
+        cout << "Largest Count:\t " << our[0].second << endl;
 }
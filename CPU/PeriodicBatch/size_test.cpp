@@ -14,14 +14,12 @@ using namespace std;
 
 using namespace groundtruth::type_info;
 
-constexpr size_t cellbits = 2;
-constexpr size_t BatchSize = (1 << cellbits);
-
-template <bool use_counter>
+template <size_t cellbits, bool use_counter>
 void periodic_size_test(
     const vector<Record>& input,
     vector<pair<PeriodicKey, int>>& ans
 ) {
+    constexpr size_t BatchSize = (1 << cellbits);
     printName(sketchName);
     sort(ans.begin(), ans.end());
     vector<pair<PeriodicKey, int>> our;
@@ -55,13 +53,14 @@ void periodic_size_test(
     };
     for (int t = 0; t < repeat_time; ++t) {
         if (sketchName == 1)
-            check(HyperCalm(BATCH_TIME, UNIT_TIME, memory, t));
+            check(HyperCalm<cellbits>(BATCH_TIME, UNIT_TIME, memory, t));
         else if (sketchName == 2)
             check(ClockUSS<use_counter>(BATCH_TIME, UNIT_TIME, memory, t));
     }
     cout << "---------------------------------------------" << endl;
     if constexpr (use_counter)
-        cout << "Results with counter:" << endl;
+        cout << "Results with counter (cell bits = " << cellbits
+             << ", batch size = " << BatchSize << "):" << endl;
     else
         cout << "Results without counter:" << endl;
     cout << "Average Speed:\t " << 1e3 * input.size() * repeat_time / time_ns << " M/s" << endl;
@@ -80,17 +79,24 @@ int main(int argc, char** argv) {
     cout << "---------------------------------------------" << '\n';
     groundtruth::item_count(input);
     groundtruth::adjust_params(input, BATCH_TIME, UNIT_TIME);
-    auto batches = groundtruth::batch(input, BATCH_TIME, BatchSize).first;
-    auto ans = groundtruth::topk(input, batches, UNIT_TIME, TOPK_THRESHOLD);
     printf("BATCH_TIME = %f, UNIT_TIME = %f\n", BATCH_TIME, UNIT_TIME);
     if (memory > 1000)
         cout << "Total Memory: " << memory / 1000. << " KB";
     else
         cout << "Total Memory: " << memory << " B";
     cout << ", Top K: " << TOPK_THRESHOLD << '\n';
-    cout << "---------------------------------------------" << '\n';
-    periodic_size_test<true>(input, ans);
+    // each cell width supports a batch size threshold up to 2^cellbits
+    auto test_cellbits = [&] (auto cellbits) {
+        constexpr size_t BatchSize = 1 << decltype(cellbits)::value;
+        cout << "---------------------------------------------" << '\n';
+        auto batches = groundtruth::batch(input, BATCH_TIME, BatchSize).first;
+        auto ans = groundtruth::topk(input, batches, UNIT_TIME, TOPK_THRESHOLD);
+        periodic_size_test<decltype(cellbits)::value, true>(input, ans);
+    };
+    test_cellbits(integral_constant<size_t, 2>());
+    test_cellbits(integral_constant<size_t, 3>());
+    test_cellbits(integral_constant<size_t, 4>());
     // cout << "---------------------------------------------" << endl;
-    // periodic_size_test<false>(input, ans);
+    // periodic_size_test<2, false>(input, ans);
     cout << "---------------------------------------------" << endl;
 }
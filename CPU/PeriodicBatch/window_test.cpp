@@ -0,0 +1,92 @@
+// Checks that windowed HyperCalm finds the periodic batches HyperCalm finds,
+// at the default memory and with a window covering the whole trace, on a
+// synthetic trace, so it needs no dataset. Exits with 1 if the recall of
+// windowed HyperCalm falls below 90% of that of HyperCalm.
+//
+// Usage: ./window_test [MEMORY] [TOPK]
+//
+// Each periodic key sends 50 to 450 batches of 1 to 4 items, 2 microseconds
+// apart, with a period of 1 to 200 UNIT_TIMEs. As many items again come from
+// random keys that never repeat.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#include "params.h"
+
+using namespace std;
+
+#include "../HyperCalm/HyperCalm.h"
+#include "../HyperCalm/WindowedHyperCalm.h"
+#include "../ComparedAlgorithms/groundtruth.h"
+
+using namespace groundtruth::type_info;
+
+vector<Record> synthetic_trace(int keys) {
+    mt19937_64 rng(1);
+    uniform_real_distribution<double> jitter(-0.1, 0.1);
+    vector<pair<double, uint32_t>> items;
+    double duration = 0;
+    for (int k = 0; k < keys; ++k) {
+        uint32_t key = uint32_t(rng()) | 1;
+        int units = 1 + rng() % 200, batches = 50 + rng() % 400;
+        double t = UNIT_TIME * (rng() % 200);
+        for (int b = 0; b < batches; ++b) {
+            int size = 1 + rng() % 4;
+            for (int i = 0; i < size; ++i)
+                items.emplace_back(t + i * 2e-6, key);
+            // the middle of a unit, so that the jitter keeps the delta
+            t += (units + 0.5 + jitter(rng)) * UNIT_TIME;
+        }
+        duration = max(duration, t);
+    }
+    size_t periodic_items = items.size();
+    uniform_real_distribution<double> when(0, duration);
+    for (size_t i = 0; i < periodic_items; ++i)
+        items.emplace_back(when(rng), uint32_t(rng()) | 1);
+    sort(items.begin(), items.end());
+    vector<Record> input;
+    for (auto& [time, key] : items)
+        input.emplace_back(key, float(time));
+    return input;
+}
+
+template <typename Sketch>
+double recall(Sketch&& sketch, const vector<Record>& input, const vector<pair<PeriodicKey, int>>& ans) {
+    for (auto &[tkey, ttime] : input)
+        sketch.insert(tkey, ttime);
+    vector<pair<PeriodicKey, int>> our = sketch.get_top_k(TOPK_THRESHOLD);
+    int corret_count = 0;
+    for (auto &[key, freq] : our)
+        corret_count += binary_search(ans.begin(), ans.end(), make_pair(key, 0),
+            [](auto& a, auto& b) { return a.first < b.first; });
+    return 1.0 * corret_count / ans.size();
+}
+
+int main(int argc, char** argv) {
+    if (argc > 1)
+        memory = atoi(argv[1]);
+    if (argc > 2)
+        TOPK_THRESHOLD = atoi(argv[2]);
+    BATCH_TIME = 1e-3;
+    UNIT_TIME = 5e-3;
+    auto input = synthetic_trace(1000);
+    auto batches = groundtruth::batch(input, BATCH_TIME, BATCH_SIZE_LIMIT).first;
+    auto ans = groundtruth::topk(input, batches, UNIT_TIME, TOPK_THRESHOLD);
+    sort(ans.begin(), ans.end());
+    printf("Items: %zu, Total Memory: %d B, Top K: %d\n", input.size(), memory, TOPK_THRESHOLD);
+    printf("---------------------------------------------\n");
+
+    double window_time = 2 * (input.back().second - input.front().second);
+    double full = recall(HyperCalm(BATCH_TIME, UNIT_TIME, memory, 0), input, ans);
+    double windowed = recall(WindowedHyperCalm(BATCH_TIME, UNIT_TIME, memory, 0, window_time), input, ans);
+    printf("---------------------------------------------\n");
+    printf("HyperCalm Recall:\t %f\n", full);
+    printf("Windowed Recall:\t %f\n", windowed);
+    bool pass = full > 0 && windowed >= 0.9 * full;
+    printf("%s\n", pass ? "PASS" : "FAIL: windowed HyperCalm misses the periodic batches of HyperCalm");
+    return pass ? 0 : 1;
+}
@@ -3,8 +3,6 @@
 
 #include "SpaceSavingTopK.h"
 
-#define tail_node nodes[0].prev
-
 class CalmSpaceSavingTopK : public SpaceSavingTopK
 {
     pair<int,int> *q;//pair(key,count)
@@ -17,11 +15,12 @@ const int count_threshold, q_size;
             ++q[i].second;
             if(q[i].second<count_threshold)return ;
             q[i]={0,0};
-            uint32_t old_key = tail_node->key;
+            NodeIndex tail = tail_node();
+            uint32_t old_key = nodes[tail].key;
             hash_table.erase(old_key);
-            tail_node->key = key;
-            hash_table[key] = tail_node;
-            add_counter(tail_node, count_threshold);
+            nodes[tail].key = key;
+            hash_table[key] = tail;
+            add_counter(tail, count_threshold);
             return ;
         }
         for(int i = 0; i < q_size; ++i)
@@ -29,11 +28,12 @@ const int count_threshold, q_size;
             q[i] = {key, 1};
             if(q[i].second<count_threshold)return ;
             q[i]={0,0};
-            uint32_t old_key = tail_node->key;
+            NodeIndex tail = tail_node();
+            uint32_t old_key = nodes[tail].key;
             hash_table.erase(old_key);
-            tail_node->key = key;
-            hash_table[key] = tail_node;
-            add_counter(tail_node, count_threshold);
+            nodes[tail].key = key;
+            hash_table[key] = tail;
+            add_counter(tail, count_threshold);
             return ;
         }
         q[q_head] = {key, 1};
@@ -68,6 +68,5 @@ public:
         }
     }
 };
-#undef tail_node
 
 #endif //_CSPACESAVINGTOPK_H_
\ No newline at end of file
@@ -2,38 +2,40 @@
 #define _SPACESAVINGTOPK_H_
 
 #include "../lib/HashTable.h"
+#include "../lib/StreamSummary.h"
 #include "SpaceSavingUtilsTopK.h"
 
-#define tail_node nodes[0].prev
-
 class SpaceSavingTopK
 {
 protected:
+    using Summary = StreamSummary<uint32_t>;
+    using NodeIndex = Summary::Index;
+
     int now_element, capacity;
     Node *nodes;
-    Hash_table<uint32_t, Node *> hash_table;
+    Summary summary;
+    Hash_table<uint32_t, NodeIndex> hash_table;
 
+    /// @brief the node to replace, @see StreamSummary::tail
+    NodeIndex tail_node() const {
+        return summary.tail();
+    }
 
     void append_new_key1(uint32_t key, int freq) {
-        uint16_t idx = ++now_element; // we use 0 to represent header
+        NodeIndex idx = ++now_element; // we use 0 to represent header
         nodes[idx].key = key;
-        nodes[idx].val = 0;
-        hash_table[key] = nodes + idx;
+        hash_table[key] = idx;
 
         // append to tail
-        nodes[idx].prev = tail_node;
-        tail_node->next = nodes + idx;
-        nodes[idx].next = nodes;
-        nodes[idx].parent = nodes + idx;
-        tail_node = &nodes[idx];
-        add_counter(tail_node, freq);
+        summary.append(idx, freq);
     }
     void append_new_key2(uint32_t key, int freq) {
-        uint32_t old_key = tail_node->key;
+        NodeIndex tail = tail_node();
+        uint32_t old_key = nodes[tail].key;
         hash_table.erase(old_key);
-        tail_node->key = key;
-        hash_table[key] = tail_node;
-        add_counter(tail_node, freq);
+        nodes[tail].key = key;
+        hash_table[key] = tail;
+        add_counter(tail, freq);
     }
     void append_new_key(uint32_t key, int freq) {
         if (now_element < capacity) {
@@ -43,56 +45,18 @@ protected:
         }
     }
 
-    void add_counter(Node * my, int freq) {
-        //if(now_element == capacity && my->val == tail_node->val)
-        //    freq++;
-
-        if (my->parent == my && my->next->val == my->val) {
-            Node * p = my->next, * nt = my->next;
-            while (p && p->val == my->val) {
-                p->parent = nt;
-                p = p->next;
-            }
-        }
-
-        my->val += freq;
-        int now_freq = my->val;
-        Node * prev_node = my->prev;
-
-        if (prev_node->val > now_freq) {
-            return;
-        }
-
-        Node * next_node = my->next;
-
-        // make next and prev connect
-        prev_node->next = my->next;
-        next_node->prev = my->prev;
-
-        while (prev_node->val < now_freq) {
-            prev_node = prev_node->parent->prev;
-        }
-
-        next_node = prev_node->next;
-
-        my->next = prev_node->next;
-        prev_node->next = my;
-
-        my->prev = next_node->prev;
-        next_node->prev = my;
-
-        my->parent = (prev_node->val == my->val) ? prev_node->parent : my;
+    void add_counter(NodeIndex my, int freq) {
+        summary.add(my, freq);
     }
 public:
     SpaceSavingTopK(int memory) : now_element(0),
-            capacity(memory/(sizeof(Node)+sizeof(Hash_table<uint32_t, Node*>::Node))-1)
-            ,hash_table(capacity+1){
+            capacity(largest_fitting(memory, [](int c) {
+                return (c + 1) * (sizeof(Node) + Summary::BytesPerCounter) + Hash_table<uint32_t, NodeIndex>::bytes(c + 1);
+            }))
+            ,summary(capacity),hash_table(capacity+1){
         nodes = new Node [capacity+1];
         memset(nodes, 0, (capacity + 1) * sizeof(Node));
         now_element = 0;
-        nodes[0].val = -1;
-        nodes[0].parent = nodes;
-        tail_node = nodes;
     }
     ~SpaceSavingTopK(){
         delete [] nodes;
@@ -114,14 +78,13 @@ public:
     vector<pair<int,int>> get_top_k(int k) {
         vector<pair<int,int>> ans;
 
-        Node * idx = nodes[0].next;
+        NodeIndex idx = summary.first();
         for(int i = 0; i < k && i < capacity && i < now_element; ++i){
-            ans.push_back( {idx->key, idx->val} );
-            idx = idx->next; 
+            ans.push_back( {nodes[idx].key, summary.value(idx)} );
+            idx = summary.next(idx); 
         }
         return ans; 
     }
 };
-#undef tail_node
 
 #endif //_SPACESAVINGTOPK_H_
\ No newline at end of file
@@ -3,14 +3,10 @@
 
 #include <cstdint>
 
+// The values and the value order of the nodes are kept in a StreamSummary.
 struct Node
 {
     uint32_t key;
-    uint32_t val;
-    Node * prev;
-    Node * next;
-    Node * parent;
-    Node * next1;
 };
 
 /*
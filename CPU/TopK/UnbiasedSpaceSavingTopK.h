@@ -4,20 +4,19 @@
 #include "SpaceSavingTopK.h"
 #include <random>
 
-#define tail_node nodes[0].prev
-
 class UnbiasedSpaceSavingTopK : public SpaceSavingTopK
 {
     mt19937 rng;
 
     void append_new_key2(uint32_t key, int freq) {
-        if(rng() % (tail_node->val+1) == 0){
-            uint32_t old_key = tail_node->key;
+        NodeIndex tail = tail_node();
+        if(rng() % (summary.value(tail)+1) == 0){
+            uint32_t old_key = nodes[tail].key;
             hash_table.erase(old_key);
-            tail_node->key = key;
-            hash_table[key] = tail_node;
+            nodes[tail].key = key;
+            hash_table[key] = tail;
         }
-        add_counter(tail_node, freq);
+        add_counter(tail, freq);
     }
     void append_new_key(uint32_t key, int freq) {
         if (now_element < capacity) {
@@ -46,6 +45,5 @@ public:
         }
     }
 };
-#undef tail_node
 
 #endif //_UNBIASEDSPACESAVINGTOPK_H_
\ No newline at end of file
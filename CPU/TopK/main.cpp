@@ -1,6 +1,7 @@
 #include <string.h>
 #include <cstdint>
 #include <cstdlib>
+#include <ctime>
 #include <vector>
 using namespace std;
 
@@ -56,11 +57,18 @@ void ParseArgs(int argc, char** argv) {
 int main(int argc, char** argv) {
 	ParseArgs(argc, argv);
 	printf("---------------------------------------------\n");
+	timespec load_start, load_end;
+	clock_gettime(CLOCK_MONOTONIC, &load_start);
 	vector<pair<uint32_t, float>> input;
-	if (fileName.back() == 't')
+	if (columnar::is_columnar(fileName.c_str()))
+		input = load_columnar(fileName.c_str());
+	else if (fileName.back() == 't')
 		input = loadCAIDA(fileName.c_str());
 	else
 		input = loadCRITEO(fileName.c_str());
+	clock_gettime(CLOCK_MONOTONIC, &load_end);
+	printf("Startup Time:\t %.1f ms (loading %zu items)\n",
+		(load_end.tv_sec - load_start.tv_sec) * 1e3 + (load_end.tv_nsec - load_start.tv_nsec) / 1e6, input.size());
 	auto ans = groundtruth(input, TOPK_THERSHOLD);
 	sort(ans.begin(), ans.end());
 	printf("---------------------------------------------\n");
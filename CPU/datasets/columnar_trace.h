@@ -0,0 +1,281 @@
+#ifndef _COLUMNAR_TRACE_H_
+#define _COLUMNAR_TRACE_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "text_trace.h"
+
+// The columnar trace format keeps the keys and the times of a trace in
+// separate columns, cut into blocks that decode on their own:
+//
+//   header     ColumnarHeader
+//   index      one ColumnarBlock per block: its file offset and first tick
+//   blocks     the key column, then the time column of each block
+//
+// Times are integer ticks of header.tick time units, so a time is restored
+// within half a tick. The time column holds the difference of each tick to
+// the previous one, zigzag and LEB128 encoded, mostly 1 to 3 bytes.
+//
+// The key column is 4 bytes per key, or with ColumnarDictionary a block
+// dictionary of its distinct keys, most frequent first, and the LEB128
+// index of each key in it, so the hottest 128 keys of a block take a byte.
+namespace columnar {
+
+constexpr char Magic[8] = { 'H', 'C', 'T', 'R', 'A', 'C', 'E', 'C' };
+constexpr uint32_t Version = 1;
+constexpr uint32_t ColumnarDictionary = 1;
+
+struct ColumnarHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t flags;
+    uint64_t records;
+    double tick;
+    uint32_t block_records;
+    uint32_t blocks;
+};
+
+struct ColumnarBlock {
+    uint64_t offset;
+    int64_t first_tick;
+};
+
+inline void put_varint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+/// @brief read a varint at p, no further than end, and move p past it.
+inline uint64_t get_varint(const uint8_t*& p, const uint8_t* end) {
+    uint64_t v = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+        if (p == end)
+            throw std::invalid_argument("ColumnarTrace: truncated file");
+        uint8_t byte = *p++;
+        v |= uint64_t(byte & 0x7F) << shift;
+        if (!(byte & 0x80))
+            return v;
+    }
+    throw std::invalid_argument("ColumnarTrace: bad varint");
+}
+
+inline uint64_t zigzag(int64_t v) {
+    return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return int64_t(v >> 1) ^ -int64_t(v & 1);
+}
+
+/// @brief whether the file starts with the header of the columnar format.
+inline bool is_columnar(const char* filename) {
+    FILE* pf = fopen(filename, "rb");
+    if (!pf)
+        return false;
+    char magic[sizeof(Magic)];
+    bool res = fread(magic, 1, sizeof(magic), pf) == sizeof(magic) && !memcmp(magic, Magic, sizeof(Magic));
+    fclose(pf);
+    return res;
+}
+
+/// @brief write the records in the columnar format.
+/// @param tick the time units of a tick, 1e-9 for nanoseconds of a second
+/// @param dictionary whether keys are coded by a dictionary of each block
+template <typename Records>
+void write_columnar(const char* filename, const Records& records, double tick,
+    bool dictionary = false, uint32_t block_records = 1 << 16) {
+    ColumnarHeader header;
+    memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.flags = dictionary ? ColumnarDictionary : 0;
+    header.records = records.size();
+    header.tick = tick;
+    header.block_records = block_records;
+    header.blocks = uint32_t((records.size() + block_records - 1) / block_records);
+
+    std::vector<ColumnarBlock> index(header.blocks);
+    std::vector<uint8_t> data;
+    uint64_t offset = sizeof(header) + index.size() * sizeof(ColumnarBlock);
+    for (uint32_t b = 0; b < header.blocks; ++b) {
+        size_t begin = size_t(b) * block_records;
+        size_t end = std::min(records.size(), begin + block_records);
+        index[b].offset = offset + data.size();
+        if (dictionary) {
+            std::unordered_map<uint32_t, uint32_t> count;
+            for (size_t i = begin; i < end; ++i)
+                ++count[records[i].first];
+            std::vector<std::pair<uint32_t, uint32_t>> keys(count.begin(), count.end());
+            std::sort(keys.begin(), keys.end(), [](auto& a, auto& b) {
+                return a.second != b.second ? a.second > b.second : a.first < b.first;
+            });
+            std::unordered_map<uint32_t, uint32_t> code;
+            uint32_t dict_size = keys.size();
+            data.insert(data.end(), (uint8_t*)&dict_size, (uint8_t*)(&dict_size + 1));
+            for (uint32_t i = 0; i < dict_size; ++i) {
+                code[keys[i].first] = i;
+                data.insert(data.end(), (uint8_t*)&keys[i].first, (uint8_t*)(&keys[i].first + 1));
+            }
+            for (size_t i = begin; i < end; ++i)
+                put_varint(data, code[records[i].first]);
+        } else {
+            for (size_t i = begin; i < end; ++i) {
+                uint32_t key = records[i].first;
+                data.insert(data.end(), (uint8_t*)&key, (uint8_t*)(&key + 1));
+            }
+        }
+        int64_t last = index[b].first_tick = llround(records[begin].second / tick);
+        for (size_t i = begin; i < end; ++i) {
+            int64_t t = llround(records[i].second / tick);
+            put_varint(data, zigzag(t - last));
+            last = t;
+        }
+    }
+
+    FILE* pf = fopen(filename, "wb");
+    if (!pf) {
+        printf("cannot open %s\n", filename);
+        exit(-1);
+    }
+    fwrite(&header, sizeof(header), 1, pf);
+    fwrite(index.data(), sizeof(ColumnarBlock), index.size(), pf);
+    fwrite(data.data(), 1, data.size(), pf);
+    fclose(pf);
+}
+
+/// @brief A columnar trace file, mapped and decoded on all cores, each
+/// block straight into its place in the result.
+class ColumnarTrace {
+public:
+    using Record = std::pair<uint32_t, float>;
+
+    explicit ColumnarTrace(const char* filename) : text(filename) {
+        if (text.size() < sizeof(header)) {
+            printf("%s is no columnar trace\n", filename);
+            exit(-1);
+        }
+        memcpy(&header, text.begin(), sizeof(header));
+        if (memcmp(header.magic, Magic, sizeof(Magic)) || header.version != Version
+            || text.size() < sizeof(header) + header.blocks * sizeof(ColumnarBlock)) {
+            printf("%s is no columnar trace of version %u\n", filename, Version);
+            exit(-1);
+        }
+        index.resize(header.blocks);
+        memcpy(index.data(), text.begin() + sizeof(header), index.size() * sizeof(ColumnarBlock));
+        // each block is decoded between its offset and the next one
+        uint64_t data_start = sizeof(header) + index.size() * sizeof(ColumnarBlock);
+        if (header.records && (!header.block_records
+            || (header.records + header.block_records - 1) / header.block_records != header.blocks))
+            throw std::invalid_argument("ColumnarTrace: bad block count");
+        for (uint32_t b = 0; b < header.blocks; ++b) {
+            if (index[b].offset < data_start || index[b].offset > block_end(b))
+                throw std::invalid_argument("ColumnarTrace: truncated file");
+        }
+    }
+
+    size_t size() const { return header.records; }
+    double tick() const { return header.tick; }
+
+    /// @brief call f(i, key, time) on every record i, the blocks on all cores.
+    /// @details throws std::invalid_argument on a truncated or corrupt block,
+    ///          after all threads have stopped.
+    template <typename Func>
+    void decode(Func&& f) const {
+        std::atomic<uint32_t> next{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error;
+        int threads = std::min<int>(header.blocks, std::max(1u, std::thread::hardware_concurrency()));
+        text_trace::run_parallel(std::max(threads, 1), [&](int) {
+            try {
+                for (uint32_t b; !failed && (b = next++) < header.blocks;)
+                    decode_block(b, f);
+            } catch (...) {
+                if (!failed.exchange(true))
+                    error = std::current_exception();
+            }
+        });
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /// @brief the key and time columns, for the batched insert of the sketches.
+    void columns(std::vector<uint32_t>& keys, std::vector<float>& times) const {
+        keys.resize(size());
+        times.resize(size());
+        decode([&](size_t i, uint32_t key, float time) {
+            keys[i] = key;
+            times[i] = time;
+        });
+    }
+
+    std::vector<Record> records() const {
+        std::vector<Record> res(size());
+        decode([&](size_t i, uint32_t key, float time) { res[i] = { key, time }; });
+        return res;
+    }
+
+private:
+    text_trace::MappedText text;
+    ColumnarHeader header;
+    std::vector<ColumnarBlock> index;
+
+    // the file offset where block b ends, the start of the next block
+    uint64_t block_end(uint32_t b) const {
+        return b + 1 < header.blocks ? std::min<uint64_t>(index[b + 1].offset, text.size()) : text.size();
+    }
+
+    template <typename Func>
+    void decode_block(uint32_t b, Func& f) const {
+        size_t begin = size_t(b) * header.block_records;
+        size_t n = std::min<size_t>(header.block_records, header.records - begin);
+        const uint8_t* p = (const uint8_t*)text.begin() + index[b].offset;
+        const uint8_t* end = (const uint8_t*)text.begin() + block_end(b);
+        auto need = [&](uint64_t bytes) {
+            if (uint64_t(end - p) < bytes)
+                throw std::invalid_argument("ColumnarTrace: truncated file");
+        };
+        std::vector<uint32_t> keys(n);
+        if (header.flags & ColumnarDictionary) {
+            uint32_t dict_size;
+            need(sizeof(dict_size));
+            memcpy(&dict_size, p, sizeof(dict_size));
+            p += sizeof(dict_size);
+            need(uint64_t(dict_size) * sizeof(uint32_t));
+            const uint8_t* dict = p;
+            p += size_t(dict_size) * sizeof(uint32_t);
+            for (size_t i = 0; i < n; ++i) {
+                uint64_t code = get_varint(p, end);
+                if (code >= dict_size)
+                    throw std::invalid_argument("ColumnarTrace: key out of the dictionary");
+                memcpy(&keys[i], dict + code * sizeof(uint32_t), sizeof(uint32_t));
+            }
+        } else {
+            need(n * sizeof(uint32_t));
+            memcpy(keys.data(), p, n * sizeof(uint32_t));
+            p += n * sizeof(uint32_t);
+        }
+        int64_t t = index[b].first_tick;
+        for (size_t i = 0; i < n; ++i) {
+            t += unzigzag(get_varint(p, end));
+            f(begin + i, keys[i], float(t * header.tick));
+        }
+    }
+};
+
+} // namespace columnar
+
+#endif // _COLUMNAR_TRACE_H_
@@ -0,0 +1,67 @@
+// Converts a trace to the columnar format of columnar_trace.h, which
+// load_data recognizes by its header whatever the file name.
+//
+// Usage: ./convert_trace INPUT OUTPUT [-F caida|raw|criteo|cache] [-u TICK] [-z]
+//
+// The input format defaults to the one load_data picks by the name, and
+// must be given for the "key time" lines of the cache test. Times are
+// stored in ticks of TICK, 1e-9 by default and 1 for CRITEO, whose times
+// are line numbers. -z codes the keys of each block by a dictionary.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "trace_utils.h"
+
+int main(int argc, char** argv) {
+    if (argc < 3) {
+        printf("Usage: %s INPUT OUTPUT [-F caida|raw|criteo|cache] [-u TICK] [-z]\n", argv[0]);
+        return 0;
+    }
+    string format;
+    double tick = 0;
+    bool dictionary = false;
+    for (int i = 3; i < argc; ++i) {
+        if (!strcmp(argv[i], "-F") && i + 1 < argc)
+            format = argv[++i];
+        else if (!strcmp(argv[i], "-u") && i + 1 < argc)
+            tick = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-z"))
+            dictionary = true;
+        else {
+            printf("unknown option %s\n", argv[i]);
+            return -1;
+        }
+    }
+
+    string input = argv[1];
+    vector<Record> records;
+    if (format.empty() && input[0] != '[')
+        format = input.back() == 't' ? "caida" : input.back() == 'w' ? "raw" : "criteo";
+    if (format.empty())
+        records = load_data(input);
+    else if (format == "caida")
+        records = loadCAIDA(input.c_str());
+    else if (format == "raw")
+        records = load_raw_data(input.c_str());
+    else if (format == "criteo")
+        records = loadCRITEO(input.c_str());
+    else if (format == "cache")
+        records = text_trace::parse_key_time(input.c_str());
+    else {
+        printf("unknown format %s\n", format.c_str());
+        return -1;
+    }
+    if (tick <= 0)
+        tick = format == "criteo" ? 1 : 1e-9;
+
+    columnar::write_columnar(argv[2], records, tick, dictionary);
+    FILE* pf = fopen(argv[2], "rb");
+    fseek(pf, 0, SEEK_END);
+    long bytes = ftell(pf);
+    fclose(pf);
+    printf("%zu items written to %s, %.2f bytes per item\n",
+        records.size(), argv[2], records.empty() ? 0. : double(bytes) / records.size());
+}
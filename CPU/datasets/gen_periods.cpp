@@ -0,0 +1,72 @@
+// Writes a synthetic trace in the format of CAIDA.dat (a 4-byte key, 9 more
+// bytes of flow ID and an 8-byte timestamp per item), where every key
+// repeats its batches with many different periods, to stress the (key,
+// delta) lookups of CalmSS.
+//
+// Usage: ./gen_periods OUTPUT [KEYS] [PERIODS] [BATCHES] [UNIT_TIME]
+//
+// Each key cycles through PERIODS periods, drawn from 1 to 200 UNIT_TIMEs,
+// and sends BATCHES batches of 1 to 4 items, 2 microseconds apart. As many
+// items again come from random keys that never repeat a period.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("Usage: %s OUTPUT [KEYS] [PERIODS] [BATCHES] [UNIT_TIME]\n", argv[0]);
+        return 0;
+    }
+    int keys = argc > 2 ? atoi(argv[2]) : 2000;
+    int periods = argc > 3 ? atoi(argv[3]) : 32;
+    int batches = argc > 4 ? atoi(argv[4]) : 800;
+    double unit_time = argc > 5 ? atof(argv[5]) : 0.005;
+
+    mt19937_64 rng(1);
+    uniform_real_distribution<double> jitter(-0.1, 0.1);
+    vector<pair<double, uint32_t>> items;
+    double duration = 0;
+    for (int k = 0; k < keys; ++k) {
+        uint32_t key = uint32_t(rng()) | 1;
+        vector<int> units(periods);
+        for (int& u : units)
+            u = 1 + rng() % 200;
+        double t = unit_time * (rng() % 200);
+        for (int b = 0; b < batches; ++b) {
+            int size = 1 + rng() % 4;
+            for (int i = 0; i < size; ++i)
+                items.emplace_back(t + i * 2e-6, key);
+            // the middle of a unit, so that the jitter keeps the delta
+            t += (units[b % periods] + 0.5 + jitter(rng)) * unit_time;
+        }
+        duration = max(duration, t);
+    }
+    size_t periodic_items = items.size();
+    uniform_real_distribution<double> when(0, duration);
+    for (size_t i = 0; i < periodic_items; ++i)
+        items.emplace_back(when(rng), uint32_t(rng()) | 1);
+    sort(items.begin(), items.end());
+
+    FILE* pf = fopen(argv[1], "wb");
+    if (!pf) {
+        printf("cannot open %s\n", argv[1]);
+        return -1;
+    }
+    char trace[21] = {};
+    for (auto& [time, key] : items) {
+        memcpy(trace, &key, sizeof(key));
+        memcpy(trace + 13, &time, sizeof(time));
+        fwrite(trace, 1, sizeof(trace), pf);
+    }
+    fclose(pf);
+    printf("%zu items of %d periodic keys over %.1f s written to %s\n",
+        items.size(), keys, duration, argv[1]);
+}
@@ -0,0 +1,126 @@
+#ifndef _MAPPED_TRACE_H_
+#define _MAPPED_TRACE_H_
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// MappedTrace maps a binary trace file into memory and decodes a record only
+// when it is read, so a trace is iterated without being loaded or copied.
+// Records have a fixed size, so the view has random access too.
+//
+// - CAIDA: 21 bytes per record, the first 4 bytes of the flow ID as the key
+//   and a double timestamp at byte 13, taken relative to the first record.
+// - Raw: 8 bytes per record, a uint32_t key and a float timestamp.
+//
+// The pages are read by the kernel on first access, ahead of a sequential
+// scan. A trailing partial record is ignored.
+class MappedTrace {
+public:
+    using Record = std::pair<uint32_t, float>;
+    enum Format { CAIDA, Raw };
+
+    class iterator {
+    public:
+        using iterator_category = std::random_access_iterator_tag;
+        using value_type = Record;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = Record;
+
+        iterator() = default;
+        iterator(const MappedTrace* trace, size_t i) : trace(trace), i(i) {}
+
+        Record operator*() const { return (*trace)[i]; }
+        Record operator[](difference_type n) const { return (*trace)[i + n]; }
+        iterator& operator++() { ++i; return *this; }
+        iterator operator++(int) { return { trace, i++ }; }
+        iterator& operator--() { --i; return *this; }
+        iterator operator--(int) { return { trace, i-- }; }
+        iterator& operator+=(difference_type n) { i += n; return *this; }
+        iterator& operator-=(difference_type n) { i -= n; return *this; }
+        iterator operator+(difference_type n) const { return { trace, i + n }; }
+        iterator operator-(difference_type n) const { return { trace, i - n }; }
+        difference_type operator-(const iterator& other) const { return difference_type(i - other.i); }
+        bool operator==(const iterator& other) const { return i == other.i; }
+        bool operator!=(const iterator& other) const { return i != other.i; }
+        bool operator<(const iterator& other) const { return i < other.i; }
+        bool operator>(const iterator& other) const { return i > other.i; }
+        bool operator<=(const iterator& other) const { return i <= other.i; }
+        bool operator>=(const iterator& other) const { return i >= other.i; }
+
+    private:
+        const MappedTrace* trace = nullptr;
+        size_t i = 0;
+    };
+
+    MappedTrace(const char* filename, Format format)
+        : stride(format == CAIDA ? 21 : sizeof(uint32_t) + sizeof(float)), format(format) {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            printf("%s not found!\n", filename);
+            exit(-1);
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            bytes = st.st_size;
+            void* addr = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                printf("cannot map %s\n", filename);
+                exit(-1);
+            }
+            data = (const char*)addr;
+            madvise(addr, bytes, MADV_SEQUENTIAL);
+        }
+        close(fd);
+        n = bytes / stride;
+        if (format == CAIDA && n)
+            base_time = caida_time(0);
+    }
+    ~MappedTrace() {
+        if (data)
+            munmap((void*)data, bytes);
+    }
+    MappedTrace(const MappedTrace&) = delete;
+    MappedTrace& operator=(const MappedTrace&) = delete;
+
+    size_t size() const { return n; }
+    bool empty() const { return !n; }
+
+    Record operator[](size_t i) const {
+        const char* p = data + i * stride;
+        uint32_t key;
+        memcpy(&key, p, sizeof(key));
+        if (format == CAIDA)
+            return { key, caida_time(i) - base_time };
+        float time;
+        memcpy(&time, p + sizeof(key), sizeof(time));
+        return { key, time };
+    }
+
+    iterator begin() const { return { this, 0 }; }
+    iterator end() const { return { this, n }; }
+
+private:
+    const char* data = nullptr;
+    size_t bytes = 0, n = 0;
+    const size_t stride;
+    const Format format;
+    double base_time = 0;
+
+    double caida_time(size_t i) const {
+        double time;
+        memcpy(&time, data + i * stride + 13, sizeof(time));
+        return time;
+    }
+};
+
+#endif // _MAPPED_TRACE_H_
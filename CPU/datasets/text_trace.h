@@ -0,0 +1,272 @@
+#ifndef _TEXT_TRACE_H_
+#define _TEXT_TRACE_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Parsing of text traces with one record per line, such as CRITEO and the
+// memory accesses of the cache test, in place of fscanf.
+//
+// The file is mapped and cut into one range per thread, each range moved to
+// start after a newline, so the threads parse whole lines on their own.
+// Lines are found with memchr and integers are read 8 digits at a time with
+// SWAR arithmetic on a 64-bit word. The records of the ranges are then
+// gathered in file order into one vector, also by all threads.
+namespace text_trace {
+
+/// @brief whether the 8 bytes at p are all ASCII digits.
+inline bool is_eight_digits(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return !(((v + 0x4646464646464646) | (v - 0x3030303030303030)) & 0x8080808080808080);
+}
+
+/// @brief the value of the 8 ASCII digits at p, the first digit the highest.
+inline uint32_t parse_eight_digits(const char* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    v -= 0x3030303030303030;
+    v = (v * 10 + (v >> 8)) & 0x00FF00FF00FF00FF;
+    v = (v * 100 + (v >> 16)) & 0x0000FFFF0000FFFF;
+    v = (v * 10000 + (v >> 32)) & 0x00000000FFFFFFFF;
+    return uint32_t(v);
+}
+
+inline bool is_digit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+inline bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+inline const char* skip_space(const char* p, const char* end) {
+    while (p < end && is_space(*p))
+        ++p;
+    return p;
+}
+
+/// @brief parse the digits at p up to end or the first non-digit, and move p past them.
+/// @details the value wraps beyond 64 bits, the digit count is added to digits.
+inline uint64_t parse_uint(const char*& p, const char* end, int* digits = nullptr) {
+    const char* start = p;
+    uint64_t v = 0;
+    while (end - p >= 8 && is_eight_digits(p)) {
+        v = v * 100000000 + parse_eight_digits(p);
+        p += 8;
+    }
+    while (p < end && is_digit(*p))
+        v = v * 10 + (*p++ - '0');
+    if (digits)
+        *digits += int(p - start);
+    return v;
+}
+
+/// @brief parse a decimal number at p as strtod does, and move p past it.
+/// @details Numbers of at most 15 significant digits without an exponent,
+/// all numbers of the traces, are one exact division of two doubles, which
+/// rounds as strtod does; others are handed to strtod.
+inline double parse_double(const char*& p, const char* end) {
+    static const double pow10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    const char* start = p;
+    bool negative = p < end && *p == '-';
+    if (p < end && (*p == '-' || *p == '+'))
+        ++p;
+    int digits = 0, frac_digits = 0;
+    uint64_t mantissa = parse_uint(p, end, &digits);
+    if (p < end && *p == '.') {
+        ++p;
+        const char* frac = p;
+        uint64_t frac_value = parse_uint(p, end, &frac_digits);
+        digits += frac_digits;
+        // leading zeros of the fraction are no significant digits
+        for (; frac < p && *frac == '0' && !mantissa; ++frac)
+            --digits;
+        if (frac_digits <= 22) {
+            uint64_t scale = 1;
+            for (int i = 0; i < frac_digits; ++i)
+                scale *= 10;
+            mantissa = mantissa * scale + frac_value;
+        }
+    }
+    bool plain = p >= end || is_space(*p);
+    if (plain && digits > 0 && digits <= 15 && frac_digits <= 22) {
+        double v = double(mantissa) / pow10[frac_digits];
+        return negative ? -v : v;
+    }
+    // exponents, long mantissas and anything else strtod reads
+    char buf[64];
+    size_t len = 0;
+    while (start + len < end && !is_space(start[len]) && len + 1 < sizeof(buf))
+        ++len;
+    memcpy(buf, start, len);
+    buf[len] = 0;
+    char* stop;
+    double v = strtod(buf, &stop);
+    p = start + (stop - buf);
+    return v;
+}
+
+/// @brief A text file mapped into memory, read only.
+class MappedText {
+public:
+    explicit MappedText(const char* filename) {
+        int fd = open(filename, O_RDONLY);
+        if (fd < 0) {
+            printf("%s not found!\n", filename);
+            exit(-1);
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            bytes = st.st_size;
+            void* addr = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                printf("cannot map %s\n", filename);
+                exit(-1);
+            }
+            data = (const char*)addr;
+            madvise(addr, bytes, MADV_SEQUENTIAL);
+        }
+        close(fd);
+    }
+    ~MappedText() {
+        if (data)
+            munmap((void*)data, bytes);
+    }
+    MappedText(const MappedText&) = delete;
+    MappedText& operator=(const MappedText&) = delete;
+
+    const char* begin() const { return data; }
+    const char* end() const { return data + bytes; }
+    size_t size() const { return bytes; }
+
+private:
+    const char* data = nullptr;
+    size_t bytes = 0;
+};
+
+/// @brief run f(i) for i in [0, n) on n threads, the last on the caller.
+template <typename Func>
+void run_parallel(int n, Func&& f) {
+    std::vector<std::thread> threads;
+    for (int i = 0; i + 1 < n; ++i)
+        threads.emplace_back(f, i);
+    f(n - 1);
+    for (auto& t : threads)
+        t.join();
+}
+
+/// @brief the number of threads for a file of the given size, one per MB at most.
+inline int thread_count(size_t bytes) {
+    int cores = std::max(1u, std::thread::hardware_concurrency());
+    return int(std::max<size_t>(1, std::min<size_t>(cores, bytes >> 20)));
+}
+
+/// @brief parse every line of the file with parse(line, line_end, field),
+/// which returns false for lines without a record, one range per thread.
+/// @return the fields of each range, the ranges in file order.
+template <typename Field, typename Parse>
+std::vector<std::vector<Field>> parse_lines(const char* filename, Parse&& parse) {
+    MappedText text(filename);
+    int n = thread_count(text.size());
+    // range i is [cuts[i], cuts[i + 1]), each cut right after a newline
+    std::vector<const char*> cuts(n + 1, text.end());
+    cuts[0] = text.begin();
+    for (int i = 1; i < n; ++i) {
+        const char* p = text.begin() + text.size() / n * i;
+        if (p <= cuts[i - 1]) {
+            cuts[i] = cuts[i - 1];
+            continue;
+        }
+        const char* nl = (const char*)memchr(p, '\n', text.end() - p);
+        cuts[i] = nl ? nl + 1 : text.end();
+    }
+    std::vector<std::vector<Field>> fields(n);
+    run_parallel(n, [&](int i) {
+        auto& res = fields[i];
+        res.reserve((cuts[i + 1] - cuts[i]) / 16);
+        for (const char* line = cuts[i]; line < cuts[i + 1];) {
+            const char* nl = (const char*)memchr(line, '\n', cuts[i + 1] - line);
+            const char* line_end = nl ? nl : cuts[i + 1];
+            Field field;
+            if (parse(line, line_end, field))
+                res.push_back(field);
+            line = line_end + 1;
+        }
+    });
+    return fields;
+}
+
+/// @brief gather the fields of parse_lines into one vector of convert(index, field).
+template <typename Out, typename Field, typename Convert>
+std::vector<Out> gather(const std::vector<std::vector<Field>>& fields, Convert&& convert) {
+    int n = fields.size();
+    std::vector<size_t> offsets(n + 1, 0);
+    for (int i = 0; i < n; ++i)
+        offsets[i + 1] = offsets[i] + fields[i].size();
+    std::vector<Out> out(offsets[n]);
+    run_parallel(n, [&](int i) {
+        for (size_t j = 0; j < fields[i].size(); ++j)
+            out[offsets[i] + j] = convert(offsets[i] + j, fields[i][j]);
+    });
+    return out;
+}
+
+/// @brief The CRITEO trace, one key a line from its 11th character, as
+/// sscanf(line + 10, "%" SCNu64) reads it. The time of a record is its line number.
+inline std::vector<std::pair<uint32_t, float>> parse_criteo(const char* filename) {
+    auto keys = parse_lines<uint32_t>(filename, [](const char* line, const char* end, uint32_t& key) {
+        line = skip_space(line, end);
+        if (end - line <= 10)
+            return false;
+        line += 10;
+        key = uint32_t(parse_uint(line, end));
+        return true;
+    });
+    return gather<std::pair<uint32_t, float>>(keys, [](size_t i, uint32_t key) {
+        return std::pair<uint32_t, float>(key, float(i + 1));
+    });
+}
+
+/// @brief The memory accesses of the cache test, "key time" a line, with
+/// times taken relative to the first record.
+inline std::vector<std::pair<uint32_t, float>> parse_key_time(const char* filename) {
+    using Field = std::pair<uint32_t, double>;
+    auto records = parse_lines<Field>(filename, [](const char* line, const char* end, Field& field) {
+        line = skip_space(line, end);
+        if (line == end)
+            return false;
+        field.first = uint32_t(parse_uint(line, end));
+        line = skip_space(line, end);
+        field.second = parse_double(line, end);
+        return true;
+    });
+    double first_time = 0;
+    for (auto& range : records) {
+        if (!range.empty()) {
+            first_time = range[0].second;
+            break;
+        }
+    }
+    return gather<std::pair<uint32_t, float>>(records, [first_time](size_t, const Field& field) {
+        return std::pair<uint32_t, float>(field.first, field.second - first_time);
+    });
+}
+
+} // namespace text_trace
+
+#endif // _TEXT_TRACE_H_
@@ -1,17 +1,35 @@
 #ifndef _TRACE_H_
 #define _TRACE_H_
 
+#include <array>
 #include <cinttypes>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 #include <fstream>
 #include <iostream>
 #include <vector>
 #include <utility>
 
+#include "columnar_trace.h"
+#include "mapped_trace.h"
+#include "text_trace.h"
+
 using Record = std::pair<uint32_t, float>;
+/// @brief The 13-byte flow ID (5-tuple) of CAIDA, usable as ByteKey<13>.
+using FlowID = std::array<uint8_t, 13>;
+using FlowRecord = std::pair<FlowID, float>;
 
+// Records are decoded from the mapped file straight into a vector of the
+// right size, @see MappedTrace to iterate the file without a copy.
 std::vector<Record> loadCAIDA(const char *filename = "./CAIDA.dat") {
+    printf("Open %s \n", filename);
+    MappedTrace trace(filename, MappedTrace::CAIDA);
+    return std::vector<Record>(trace.begin(), trace.end());
+}
+
+// Like loadCAIDA, but keeps the whole flow ID instead of its first 4 bytes.
+std::vector<FlowRecord> loadCAIDAFlows(const char *filename = "./CAIDA.dat") {
     printf("Open %s \n", filename);
     FILE *pf = fopen(filename, "rb");
     if (!pf) {
@@ -19,11 +37,12 @@ std::vector<Record> loadCAIDA(const char *filename = "./CAIDA.dat") {
         exit(-1);
     }
 
-    std::vector<Record> vec;
+    std::vector<FlowRecord> vec;
     double ftime = -1;
     char trace[30];
     while (fread(trace, 1, 21, pf)) {
-        uint32_t tkey = *(uint32_t *)(trace);
+        FlowID tkey;
+        memcpy(tkey.data(), trace, tkey.size());
         double ttime = *(double *)(trace + 13);
         if (ftime < 0)
             ftime = ttime;
@@ -33,42 +52,23 @@ std::vector<Record> loadCAIDA(const char *filename = "./CAIDA.dat") {
     return vec;
 }
 
+// One key a line from its 11th character, the time of a key is its line
+// number, parsed on all cores @see text_trace::parse_criteo.
 std::vector<Record> loadCRITEO(const char *filename = "./CRITEO.log") {
     printf("Open %s \n", filename);
-    FILE *pf = fopen(filename, "rb");
-    if (!pf) {
-        printf("%s not found!\n", filename);
-        exit(-1);
-    }
+    return text_trace::parse_criteo(filename);
+}
 
-    std::vector<Record> vec;
-    char trace[40];
-    int ttime = 0;
-    while (fscanf(pf, "%s", trace) != EOF) {
-        uint64_t tkey;
-        sscanf(trace + 10, "%" SCNu64, &tkey);
-        vec.push_back(std::pair<uint32_t, float>(tkey, ++ttime));
-    }
-    fclose(pf);
-    return vec;
+// A trace written by convert_trace, its blocks decoded on all cores.
+std::vector<Record> load_columnar(const char *filename) {
+    printf("Open %s \n", filename);
+    return columnar::ColumnarTrace(filename).records();
 }
 
 std::vector<Record> load_raw_data(const char* fileName) {
     using namespace std;
     cout << "loading raw data from " << fileName << endl;
-    char buf[20];
-	uint32_t key;
-	float time;
-	long long cnt = 0;
-	fstream fin(fileName, ios::binary | ios::in);
-    vector<Record> input;
-	while (fin.read(buf, sizeof(uint32_t) + sizeof(float))) {
-        key = *(uint32_t*)buf;
-        time = *(float*)(buf + sizeof(uint32_t));
-        input.emplace_back(key, time);
-		if (++cnt % 100000000 == 0)
-            cerr << cnt / 100000000 << "00M" << endl;
-	}
-    return input;
+    MappedTrace trace(fileName, MappedTrace::Raw);
+    return vector<Record>(trace.begin(), trace.end());
 }
 #endif // _TRACE_H_
@@ -0,0 +1,182 @@
+#ifndef _TRACE_STREAM_H_
+#define _TRACE_STREAM_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "columnar_trace.h"
+
+// TraceStream reads a binary trace in fixed-size chunks on a reader thread,
+// so the whole trace is never held in memory and reading overlaps with the
+// consumer. The reader decodes into two chunk buffers in turn: while the
+// consumer processes one chunk, the reader fills the other.
+//
+// The file name follows load_data: a name ending in 't' is CAIDA and one
+// ending in 'w' is raw, and "[Ln]pattern" chains the n files pattern % i,
+// each shifted by the last time of the parts before it, as load_large_data
+// does. Text traces are not supported.
+class TraceStream {
+public:
+    using Record = std::pair<uint32_t, float>;
+
+    explicit TraceStream(const std::string& fileName, size_t chunk_records = 1 << 20)
+        : chunk_records(chunk_records), files(expand(fileName)) {
+        for (auto& buf : bufs)
+            buf.records.resize(chunk_records);
+        reader = std::thread(&TraceStream::run, this);
+    }
+    ~TraceStream() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopped = true;
+        }
+        cv.notify_all();
+        reader.join();
+    }
+    TraceStream(const TraceStream&) = delete;
+    TraceStream& operator=(const TraceStream&) = delete;
+
+    /// @brief the next chunk of records, 0 records at the end of the trace.
+    /// @details the chunk stays valid until the next call.
+    std::pair<const Record*, size_t> next() {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (holding) {
+            // hand the chunk of the last call back to the reader
+            bufs[consumed].full = false;
+            consumed ^= 1;
+            holding = false;
+            cv.notify_all();
+        }
+        cv.wait(lock, [&] { return bufs[consumed].full || finished; });
+        if (!bufs[consumed].full)
+            return { nullptr, 0 };
+        holding = true;
+        return { bufs[consumed].records.data(), bufs[consumed].size };
+    }
+
+    /// @brief call f(key, time) on every record, return the number of records.
+    template <typename Func>
+    size_t for_each(Func&& f) {
+        size_t total = 0;
+        for (auto [records, n] = next(); n; std::tie(records, n) = next()) {
+            for (size_t i = 0; i < n; ++i)
+                f(records[i].first, records[i].second);
+            total += n;
+        }
+        return total;
+    }
+
+    /// @brief the memory taken by the chunk buffers, whatever the trace length.
+    size_t buffer_bytes() const {
+        return 2 * chunk_records * (sizeof(Record) + 21);
+    }
+
+private:
+    struct Buffer {
+        std::vector<Record> records;
+        size_t size = 0;
+        bool full = false;
+    };
+
+    const size_t chunk_records;
+    const std::vector<std::string> files;
+    Buffer bufs[2];
+    int consumed = 0; // the buffer the consumer reads next
+    bool holding = false, finished = false, stopped = false;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread reader;
+
+    static std::vector<std::string> expand(const std::string& fileName) {
+        if (fileName.substr(0, 2) != "[L")
+            return { fileName };
+        size_t close = fileName.find(']');
+        if (close == std::string::npos) {
+            printf("invalid file name %s\n", fileName.c_str());
+            exit(-1);
+        }
+        int total_num = close > 2 ? std::stoi(fileName.substr(2, close - 2)) : 60;
+        std::string pattern = fileName.substr(close + 1);
+        std::vector<std::string> res;
+        char buf[100];
+        for (int i = 0; i < total_num; ++i) {
+            snprintf(buf, 100, pattern.c_str(), i);
+            res.push_back(buf);
+        }
+        return res;
+    }
+
+    void run() {
+        std::vector<char> raw(chunk_records * 21);
+        int filled = 0;
+        double offset = 0;
+        for (auto& name : files) {
+            bool caida = name.back() == 't';
+            if ((!caida && name.back() != 'w') || columnar::is_columnar(name.c_str())) {
+                printf("streaming supports CAIDA (.dat) and raw (.raw) traces, not %s\n", name.c_str());
+                exit(-1);
+            }
+            FILE* pf = fopen(name.c_str(), "rb");
+            if (!pf) {
+                printf("%s not found!\n", name.c_str());
+                exit(-1);
+            }
+            size_t stride = caida ? 21 : sizeof(uint32_t) + sizeof(float);
+            double base_time = -1, last_time = 0;
+            size_t n;
+            while ((n = fread(raw.data(), stride, chunk_records, pf)) > 0) {
+                Buffer& buf = bufs[filled];
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    cv.wait(lock, [&] { return !buf.full || stopped; });
+                    if (stopped) {
+                        fclose(pf);
+                        return;
+                    }
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    const char* p = raw.data() + i * stride;
+                    uint32_t key;
+                    memcpy(&key, p, sizeof(key));
+                    double time;
+                    if (caida) {
+                        memcpy(&time, p + 13, sizeof(time));
+                        if (base_time < 0)
+                            base_time = time;
+                        time -= base_time;
+                    } else {
+                        float t;
+                        memcpy(&t, p + sizeof(key), sizeof(t));
+                        time = t;
+                    }
+                    // rounded to float first, as load_data stores each part
+                    last_time = float(time);
+                    buf.records[i] = { key, float(last_time + offset) };
+                }
+                buf.size = n;
+                {
+                    std::lock_guard<std::mutex> lock(mtx);
+                    buf.full = true;
+                }
+                cv.notify_all();
+                filled ^= 1;
+            }
+            fclose(pf);
+            offset += last_time;
+        }
+        std::lock_guard<std::mutex> lock(mtx);
+        finished = true;
+        cv.notify_all();
+    }
+};
+
+#endif // _TRACE_STREAM_H_
@@ -3,16 +3,24 @@
 
 using namespace std;
 
+#include <atomic>
+#include <ctime>
+#include <memory>
+#include <thread>
+
 #include "trace.h"
 
 using Record = pair<uint32_t, float>;
 
 vector<Record> load_large_data(const string& fileName);
 
-vector<Record> load_data(const string& fileName) {
+// load a columnar trace by its header, others by the format their name ends with
+vector<Record> load_trace(const string& fileName) {
     if (fileName.substr(0, 2) == "[L") {
         return load_large_data(fileName);
     }
+    if (columnar::is_columnar(fileName.c_str()))
+        return load_columnar(fileName.c_str());
     if (fileName.back() == 'w')
         return load_raw_data(fileName.c_str());
     else if (fileName.back() == 't')
@@ -21,8 +29,29 @@ vector<Record> load_data(const string& fileName) {
         return loadCRITEO(fileName.c_str());
 }
 
+/// @brief milliseconds since start, for the startup time of the test binaries.
+inline double elapsed_since(const timespec& start) {
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1e3 + (now.tv_nsec - start.tv_nsec) / 1e6;
+}
+
+// load_trace, reporting the load time apart from the test
+vector<Record> load_data(const string& fileName) {
+    timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    auto input = load_trace(fileName);
+    printf("Startup Time:\t %.1f ms (loading %zu items)\n", elapsed_since(start), input.size());
+    return input;
+}
+
+// The parts of "[Ln]pattern" are loaded concurrently, each straight into its
+// slice of the result. A binary part is mapped, so its record count and its
+// last time are known before it is decoded, and so are the time offsets of
+// all parts; text and columnar parts are decoded first, as only decoding
+// counts their lines or gives their last time.
+// Times are offset as if the parts were appended one by one.
 vector<Record> load_large_data(const string& fileName) {
-    vector<Record> input;
     int total_num = 60;
     if (fileName.find(']') == string::npos) {
         throw runtime_error("invalid file name");
@@ -32,15 +61,70 @@ vector<Record> load_large_data(const string& fileName) {
     }
     string fname = fileName.substr(fileName.find(']') + 1);
     char buf[100];
-    double last_time = 0;
+    struct Part {
+        string name;
+        bool columnar = false;
+        unique_ptr<MappedTrace> mapped;
+        vector<Record> parsed;
+        size_t size() const { return mapped ? mapped->size() : parsed.size(); }
+        float last_time() const {
+            if (!size())
+                return 0;
+            return mapped ? (*mapped)[size() - 1].second : parsed.back().second;
+        }
+    };
+    vector<Part> parts(total_num);
     for (int i = 0; i < total_num; ++i) {
         snprintf(buf, 100, fname.c_str(), i);
-        auto single_data = load_data(buf);
-        for (auto& [key, time] : single_data) {
-            input.emplace_back(key, time + last_time);
+        parts[i].name = buf;
+        if (columnar::is_columnar(buf)) {
+            printf("Open %s \n", buf);
+            parts[i].columnar = true;
+        } else if (parts[i].name.back() == 'w') {
+            cout << "loading raw data from " << buf << endl;
+            parts[i].mapped = make_unique<MappedTrace>(buf, MappedTrace::Raw);
+        } else {
+            printf("Open %s \n", buf);
+            if (parts[i].name.back() == 't')
+                parts[i].mapped = make_unique<MappedTrace>(buf, MappedTrace::CAIDA);
         }
-        last_time += single_data.back().second;
     }
+    // run f on every part, on as many threads as there are cores
+    auto for_each_part = [&](auto&& f) {
+        atomic<int> next{0};
+        int threads = min<int>(total_num, max(1u, thread::hardware_concurrency()));
+        text_trace::run_parallel(threads, [&](int) {
+            for (int i; (i = next++) < total_num;)
+                f(i);
+        });
+    };
+    for_each_part([&](int i) {
+        if (parts[i].columnar)
+            parts[i].parsed = columnar::ColumnarTrace(parts[i].name.c_str()).records();
+        else if (!parts[i].mapped)
+            parts[i].parsed = text_trace::parse_criteo(parts[i].name.c_str());
+    });
+    vector<size_t> start(total_num + 1, 0);
+    vector<double> offset(total_num, 0);
+    double last_time = 0;
+    for (int i = 0; i < total_num; ++i) {
+        start[i + 1] = start[i] + parts[i].size();
+        offset[i] = last_time;
+        last_time += parts[i].last_time();
+    }
+    vector<Record> input(start[total_num]);
+    for_each_part([&](int i) {
+        auto fill = [&](const auto& records) {
+            for (size_t j = 0; j < records.size(); ++j) {
+                auto [key, time] = records[j];
+                input[start[i] + j] = { key, time + offset[i] };
+            }
+        };
+        if (parts[i].mapped)
+            fill(*parts[i].mapped);
+        else
+            fill(parts[i].parsed);
+    });
     return input;
 }
 
@@ -0,0 +1,27 @@
+#ifndef _FASTRANGE_H_
+#define _FASTRANGE_H_
+
+#include <cstdint>
+#include <random>
+
+// Position hashing of the Bloom-filter-like sketches. A 32-bit key is hashed
+// by a 64-bit multiply-shift, whose upper 32 bits are all usable, and mapped
+// onto [0, n) by a multiply-high instead of a modulo, so a table of any size
+// up to 2^32 positions is covered evenly.
+
+/// @brief an odd 64-bit seed for multiplyShift.
+inline uint64_t randomOddSeed(std::mt19937_64& rng) {
+    return rng() | 1;
+}
+
+/// @brief 32-bit hash of a key, (key * seed mod 2^64) >> 32.
+inline uint32_t multiplyShift(uint32_t key, uint64_t seed) {
+    return uint32_t((key * seed) >> 32);
+}
+
+/// @brief maps a 32-bit hash onto [0, n) without a division.
+inline uint32_t fastRange(uint32_t hash, uint32_t n) {
+    return uint32_t((uint64_t(hash) * n) >> 32);
+}
+
+#endif // _FASTRANGE_H_
@@ -1,80 +1,208 @@
 #ifndef _HASHTABLE_H_
 #define _HASHTABLE_H_
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
 
-#define Mod(x) ((x%n+n)%n)
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "KeyHash.h"
+
+// Hash_table is an open-addressing table in the style of a Swiss table.
+// Slots come in groups of 16, and each slot has a control byte, either
+// Empty or 7 bits of the hash of its key, so a probe compares the 16 control
+// bytes of a group at once and only reads the keys whose bits match. The
+// number of groups is a power of two, so the home group of a key is taken
+// from its hash by a mask.
+//
+// Keys that find their home group full go on to the next groups. Each group
+// counts the keys that passed it, so a lookup stops at the first group that
+// none passed. Erasing a key decrements the counts on its way and empties
+// its slot, so no tombstones are left behind and nodes never move: a
+// pointer to a node stays valid until the node itself is erased.
 template<typename key_t, typename val_t>
 class Hash_table{
-    int n;
-    int *head;
-    int *pool,pool_n;
+    static constexpr int GroupSize = 16;
+    static constexpr uint8_t Empty = 0x80;
+    static constexpr uint8_t Saturated = 0xff;
+
+    int n, group_mask, size;
+    uint8_t *ctrl;
+    /// @brief the number of keys that passed each group, sticking at Saturated.
+    uint8_t *overflow;
+
+    static uint64_t hash_of(const key_t &key){
+        return uint64_t(KeyHash<key_t>()(key)) * 0x9e3779b97f4a7c15;
+    }
+    int home_of(uint64_t h) const{
+        return int(h >> 32) & group_mask;
+    }
+    static uint8_t tag_of(uint64_t h){
+        return uint8_t(h >> 57);
+    }
+    /// @brief bit i is set if control byte i of group g is c.
+    uint32_t match(int g, uint8_t c) const{
+        const uint8_t *p = ctrl + g * GroupSize;
+#ifdef __SSE2__
+        __m128i bytes = _mm_loadu_si128((const __m128i *)p);
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, _mm_set1_epi8(char(c))));
+#else
+        uint32_t mask = 0;
+        for(int i = 0; i < GroupSize; ++i)
+            mask |= uint32_t(p[i] == c) << i;
+        return mask;
+#endif
+    }
+    int slots() const{
+        return (group_mask + 1) * GroupSize;
+    }
+    static int slot_count(int n){
+        // at most 7/8 full when holding n keys
+        int64_t need = int64_t(n) * 8 / 7 + 1, slots = GroupSize;
+        while(slots < need) slots <<= 1;
+        return int(slots);
+    }
 public:
     struct Node{
-        int next;
         key_t first;
         val_t second;
     };
+    /// @brief the memory allocated by a table built for n keys.
+    /// @details the slots are the next power of two of at least n * 8 / 7,
+    ///          each with a node and a control byte, and a count per group.
+    static size_t bytes(int n){
+        size_t total = slot_count(n);
+        return total * (sizeof(Node) + 1) + total / GroupSize;
+    }
+
     Node *nodes;
-    Hash_table(int _n):n(_n),pool_n(_n){
-        head = new int [n];
-        nodes = new Node [n];
-        pool = new int [n];
-        for(int i=0;i<n;++i){
-            head[i] = -1;
-            pool[i] = i;
-        }
+    Hash_table(int _n):n(_n),size(0){
+        int total = slot_count(n);
+        group_mask = total / GroupSize - 1;
+        ctrl = new uint8_t [total];
+        overflow = new uint8_t [total / GroupSize] {};
+        nodes = new Node [total];
+        memset(ctrl, Empty, total);
     }
     ~Hash_table(){
-        delete [] head;
-        delete [] pool;
+        delete [] ctrl;
+        delete [] overflow;
         delete [] nodes;
     }
-    bool count(key_t key){
-        for(int i = head[Mod(key)]; i!=-1; i=nodes[i].next)
-        if(nodes[i].first==key)return 1;
-        return 0;
-    }
-    val_t& operator [](key_t key){
-        int key_mod_n = Mod(key);
-        for(int i = head[key_mod_n]; i != -1; i = nodes[i].next)
-        if(nodes[i].first == key)
-            return nodes[i].second;
-        assert(pool_n > 0);
-        --pool_n;
-        int i = pool[pool_n];
-        nodes[i].next = head[key_mod_n];
+    Hash_table(const Hash_table&) = delete;
+    Hash_table& operator=(const Hash_table&) = delete;
+
+    /// @brief erase all nodes.
+    void clear(){
+        memset(ctrl, Empty, slots());
+        memset(overflow, 0, group_mask + 1);
+        size = 0;
+    }
+    bool count(const key_t &key){
+        return find(key) != end();
+    }
+    val_t& operator [](const key_t &key){
+        uint64_t h = hash_of(key);
+        Node *p = find(key, h);
+        if(p != end())
+            return p->second;
+        assert(size < slots());
+        ++size;
+        int g = home_of(h);
+        uint32_t empty;
+        while(!(empty = match(g, Empty))){
+            if(overflow[g] != Saturated)
+                ++overflow[g];
+            g = (g + 1) & group_mask;
+        }
+        int i = g * GroupSize + __builtin_ctz(empty);
+        ctrl[i] = tag_of(h);
         nodes[i].first = key;
         nodes[i].second = val_t();
-        head[key_mod_n] = i;
         return nodes[i].second;
     }
-    Node* find(key_t key){
-        for(int i = head[Mod(key)]; i != -1; i = nodes[i].next)
-        if(nodes[i].first == key)
-            return nodes + i;
-        return nodes + n;
+    Node* find(const key_t &key){
+        return find(key, hash_of(key));
     }
     Node* end(){
-        return nodes + n;
+        return nodes + slots();
     }
     void erase(Node *p){
-        int p_i = p - nodes;
-        pool[pool_n++] = p_i;
-        int key_mod_n = Mod(p->first);
-        int i = head[key_mod_n];
-        if(i == p_i)
-            head[key_mod_n] = p->next;
-        else{
-            while(nodes[i].next != p_i) i = nodes[i].next;
-            nodes[i].next = p->next;
-        }
+        int i = p - nodes;
+        uint64_t h = hash_of(p->first);
+        for(int g = home_of(h); g != i / GroupSize; g = (g + 1) & group_mask)
+            if(overflow[g] != Saturated)
+                --overflow[g];
+        ctrl[i] = Empty;
+        --size;
     }
-    void erase(key_t key){
+    void erase(const key_t &key){
         Node *p = find(key);
         if(p != end())
             erase(p);
     }
+    // write the table into a snapshot, values are written by save_val
+    template<typename Writer, typename SaveVal>
+    void save(Writer &w, SaveVal save_val) const{
+        w.write(n);
+        w.write(size);
+        w.write_array(ctrl, slots());
+        w.write_array(overflow, group_mask + 1);
+        for(int i = 0; i < slots(); ++i)
+        if(ctrl[i] != Empty){
+            w.write(nodes[i].first);
+            save_val(nodes[i].second);
+        }
+    }
+    template<typename Reader, typename LoadVal>
+    void load(Reader &r, LoadVal load_val){
+        r.expect(n, "hash table size");
+        size = r.template read<int>();
+        r.read_array(ctrl, slots());
+        r.read_array(overflow, group_mask + 1);
+        for(int i = 0; i < slots(); ++i){
+            if(ctrl[i] == Empty)
+                continue;
+            if(ctrl[i] & Empty)
+                throw std::invalid_argument("Snapshot: bad hash table control byte");
+            nodes[i].first = r.template read<key_t>();
+            load_val(nodes[i].second);
+        }
+    }
+private:
+    Node* find(const key_t &key, uint64_t h){
+        uint8_t tag = tag_of(h);
+        int g = home_of(h);
+        for(int probes = 0; probes <= group_mask; ++probes){
+            for(uint32_t m = match(g, tag); m; m &= m - 1){
+                int i = g * GroupSize + __builtin_ctz(m);
+                if(nodes[i].first == key)
+                    return nodes + i;
+            }
+            if(!overflow[g])
+                break;
+            g = (g + 1) & group_mask;
+        }
+        return end();
+    }
 };
-#undef Mod
+
+/// @brief the largest n with cost(n) <= memory, 0 if none, for a cost growing with n.
+/// @details Sizes structures that hold a Hash_table, whose bytes grow in
+///          steps at powers of two, against a memory budget.
+template<typename Cost>
+int largest_fitting(int64_t memory, Cost cost){
+    int64_t lo = 0, hi = std::max<int64_t>(memory, 0);
+    while(lo < hi){
+        int64_t mid = (lo + hi + 1) / 2;
+        if(int64_t(cost(int(mid))) <= memory) lo = mid;
+        else hi = mid - 1;
+    }
+    return int(lo);
+}
 #endif // _HASHTABLE_H_
@@ -0,0 +1,67 @@
+#ifndef _KEYHASH_H_
+#define _KEYHASH_H_
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// KeyHash<Key> reduces a key to the 32-bit value the sketches hash and index
+// with. 32-bit keys are used as they are, so their results do not change,
+// wider integers and fixed-length byte keys are folded with multiplications
+// over 8-byte words, without leaving any byte out.
+
+/// @brief A fixed-length byte key, e.g. ByteKey<13> for a 5-tuple flow ID.
+template <size_t N>
+using ByteKey = std::array<uint8_t, N>;
+
+template <typename Key, typename = void>
+struct KeyHash;
+
+namespace key_hash_detail {
+
+static constexpr uint64_t kMul = 0x9e3779b97f4a7c15;
+
+inline uint32_t fold64(uint64_t x) {
+    x ^= x >> 32;
+    return uint32_t((x * kMul) >> 32);
+}
+
+} // namespace key_hash_detail
+
+template <typename Key>
+struct KeyHash<Key, std::enable_if_t<std::is_integral_v<Key> && sizeof(Key) <= 4>> {
+    uint32_t operator()(Key key) const {
+        return uint32_t(key);
+    }
+};
+
+template <typename Key>
+struct KeyHash<Key, std::enable_if_t<std::is_integral_v<Key> && sizeof(Key) == 8>> {
+    uint32_t operator()(Key key) const {
+        return key_hash_detail::fold64(uint64_t(key));
+    }
+};
+
+template <size_t N>
+struct KeyHash<ByteKey<N>> {
+    uint32_t operator()(const ByteKey<N>& key) const {
+        using namespace key_hash_detail;
+        uint64_t h = N * kMul;
+        size_t i = 0;
+        for (; i + 8 <= N; i += 8) {
+            uint64_t word;
+            memcpy(&word, key.data() + i, 8);
+            h = (h ^ word) * kMul;
+            h ^= h >> 29;
+        }
+        if constexpr (N % 8 != 0) {
+            uint64_t word = 0;
+            memcpy(&word, key.data() + i, N % 8);
+            h = (h ^ word) * kMul;
+        }
+        return fold64(h);
+    }
+};
+
+#endif // _KEYHASH_H_
@@ -0,0 +1,98 @@
+#ifndef _SLOTCOUNTINDEX_H_
+#define _SLOTCOUNTINDEX_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// SlotCountIndex files the slots 0..n-1 of a circular queue under a small
+// count in [0, levels), and finds the slot to reuse: the one of the smallest
+// count present, and among those the first at or after a start slot, going
+// round the queue.
+//
+// Each count keeps a bitmap of its slots, and a second bitmap telling which
+// words of the first are not empty, so a search reads one word per 4096
+// slots at most instead of every slot.
+class SlotCountIndex {
+public:
+    SlotCountIndex(int n, int levels)
+        : levels(levels), words((n + 63) / 64), groups((words + 63) / 64),
+          bits(size_t(levels) * words), nonempty(size_t(levels) * groups) {}
+
+    /// @brief the memory taken by the index of n slots.
+    static size_t bytes(int n, int levels) {
+        size_t words = (n + 63) / 64;
+        return levels * (words + (words + 63) / 64) * sizeof(uint64_t);
+    }
+
+    void clear() {
+        std::fill(bits.begin(), bits.end(), 0);
+        std::fill(nonempty.begin(), nonempty.end(), 0);
+    }
+
+    void insert(int slot, int count) {
+        int w = slot >> 6;
+        bits[size_t(count) * words + w] |= 1ULL << (slot & 63);
+        nonempty[size_t(count) * groups + (w >> 6)] |= 1ULL << (w & 63);
+    }
+    void erase(int slot, int count) {
+        int w = slot >> 6;
+        uint64_t& word = bits[size_t(count) * words + w];
+        word &= ~(1ULL << (slot & 63));
+        if (!word)
+            nonempty[size_t(count) * groups + (w >> 6)] &= ~(1ULL << (w & 63));
+    }
+    void move(int slot, int from, int to) {
+        if (from != to) {
+            erase(slot, from);
+            insert(slot, to);
+        }
+    }
+
+    /// @brief the first slot from start on of the smallest count, -1 if none is filed.
+    int find_min(int start) const {
+        for (int c = 0; c < levels; ++c) {
+            int slot = find(c, start);
+            if (slot >= 0)
+                return slot;
+        }
+        return -1;
+    }
+
+private:
+    const int levels, words, groups;
+    std::vector<uint64_t> bits, nonempty;
+
+    int find(int count, int start) const {
+        const uint64_t* b = &bits[size_t(count) * words];
+        int w = start >> 6;
+        uint64_t m = b[w] & (~0ULL << (start & 63));
+        if (m)
+            return w * 64 + __builtin_ctzll(m);
+        // the words after w, then from the first word round to w itself,
+        // whose bits before start are all that is left
+        int next = next_word(count, w + 1);
+        if (next < 0)
+            next = next_word(count, 0);
+        if (next < 0)
+            return -1;
+        return next * 64 + __builtin_ctzll(b[next]);
+    }
+
+    /// @brief the first non-empty word from w on, -1 if none.
+    int next_word(int count, int w) const {
+        if (w >= words)
+            return -1;
+        const uint64_t* g = &nonempty[size_t(count) * groups];
+        int gi = w >> 6;
+        uint64_t m = g[gi] & (~0ULL << (w & 63));
+        while (!m) {
+            if (++gi == groups)
+                return -1;
+            m = g[gi];
+        }
+        return gi * 64 + __builtin_ctzll(m);
+    }
+};
+
+#endif // _SLOTCOUNTINDEX_H_
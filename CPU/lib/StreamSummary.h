@@ -0,0 +1,189 @@
+#ifndef _STREAMSUMMARY_H_
+#define _STREAMSUMMARY_H_
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+
+// StreamSummary keeps the counters of a Space-Saving sketch sorted by value,
+// the largest first. Counters are numbered 1..capacity, 0 is the header.
+//
+// Counters of the same value form a bucket, a contiguous run of the list in
+// the order they reached the value. Each counter knows its bucket and each
+// bucket its first counter, so a counter leaves or joins a bucket in O(1),
+// and an increment by 1 is O(1). A larger increment skips whole buckets,
+// one step per distinct value passed.
+//
+// The last counter of the list, tail(), is the one to replace: the smallest
+// value, and the latest to reach it among equal ones.
+template <typename Count = uint32_t>
+class StreamSummary {
+public:
+    using Index = uint32_t;
+    static constexpr Index Header = 0;
+
+    struct Links {
+        Index prev, next;
+        Index bucket;
+    };
+
+    /// @brief The memory taken by a counter, including its share of buckets.
+    static constexpr size_t BytesPerCounter = sizeof(Count) + sizeof(Links) + sizeof(Index);
+
+    explicit StreamSummary(int capacity) : capacity(capacity) {
+        vals = new Count[capacity + 1] {};
+        links = new Links[capacity + 1] {};
+        // a bucket for the header and at most one for each counter
+        bucket_first = new Index[capacity + 2] {};
+        clear();
+    }
+    ~StreamSummary() {
+        delete[] vals;
+        delete[] links;
+        delete[] bucket_first;
+    }
+    StreamSummary(const StreamSummary&) = delete;
+    StreamSummary& operator=(const StreamSummary&) = delete;
+
+    /// @brief detach all counters, as after construction.
+    void clear() {
+        std::fill(vals, vals + capacity + 1, Count());
+        std::fill(links, links + capacity + 1, Links());
+        vals[Header] = Count(-1);
+        // bucket 0 holds the header, the others are free
+        bucket_first[0] = Header;
+        for (Index b = 1; b < Index(capacity + 1); ++b)
+            bucket_first[b] = b + 1;
+        bucket_first[capacity + 1] = 0;
+        free_bucket = 1;
+    }
+
+    Count value(Index i) const {
+        return vals[i];
+    }
+    /// @brief the counter of the largest value, Header if empty.
+    Index first() const {
+        return links[Header].next;
+    }
+    /// @brief the counter after i, Header after the last one.
+    Index next(Index i) const {
+        return links[i].next;
+    }
+    Index tail() const {
+        return links[Header].prev;
+    }
+
+    /// @brief attach the unused counter i at the tail with value 0, then add freq.
+    void append(Index i, Count freq) {
+        Index last = tail();
+        vals[i] = 0;
+        links[i].prev = last;
+        links[i].next = Header;
+        links[last].next = i;
+        links[Header].prev = i;
+        if (last != Header && vals[last] == 0)
+            links[i].bucket = links[last].bucket;
+        else
+            links[i].bucket = new_bucket(i);
+        add(i, freq);
+    }
+
+    /// @brief add freq to counter i and move it behind the counters not smaller.
+    void add(Index my, Count freq) {
+        if (!freq)
+            return;
+        Count val = vals[my] + freq;
+        vals[my] = val;
+        Index prev_node = links[my].prev;
+        Index next_node = links[my].next;
+        Index bucket = links[my].bucket;
+        bool is_last = links[next_node].bucket != bucket;
+
+        if (vals[prev_node] > val) {
+            // my is the first of its bucket and stays, in a bucket of its own
+            if (!is_last) {
+                bucket_first[bucket] = next_node;
+                links[my].bucket = new_bucket(my);
+            }
+            return;
+        }
+
+        // leave the bucket and the list
+        if (bucket_first[bucket] == my) {
+            if (is_last)
+                free_bucket_of(bucket);
+            else
+                bucket_first[bucket] = next_node;
+        }
+        links[prev_node].next = next_node;
+        links[next_node].prev = prev_node;
+
+        // the header holds the largest value, so the search stops there
+        while (vals[prev_node] < val)
+            prev_node = links[bucket_first[links[prev_node].bucket]].prev;
+
+        // prev_node is the last counter of its bucket
+        next_node = links[prev_node].next;
+        links[my].prev = prev_node;
+        links[my].next = next_node;
+        links[prev_node].next = my;
+        links[next_node].prev = my;
+        if (vals[prev_node] == val)
+            links[my].bucket = links[prev_node].bucket;
+        else
+            links[my].bucket = new_bucket(my);
+    }
+
+    /// @brief write the counters into a snapshot, @see Snapshot::Writer
+    template <typename Writer>
+    void save(Writer& w) const {
+        w.write(capacity);
+        w.write(free_bucket);
+        w.write_array(vals, capacity + 1);
+        w.write_array(links, capacity + 1);
+        w.write_array(bucket_first, capacity + 2);
+    }
+    /// @brief restore a snapshot of a summary of the same capacity.
+    template <typename Reader>
+    void load(Reader& r) {
+        r.expect(capacity, "StreamSummary capacity");
+        free_bucket = checked(r.template read<Index>(), capacity + 2);
+        r.read_array(vals, capacity + 1);
+        r.read_array(links, capacity + 1);
+        r.read_array(bucket_first, capacity + 2);
+        for (int i = 0; i <= capacity; ++i) {
+            checked(links[i].prev, capacity + 1);
+            checked(links[i].next, capacity + 1);
+            checked(links[i].bucket, capacity + 2);
+        }
+        for (int b = 0; b < capacity + 2; ++b)
+            checked(bucket_first[b], capacity + 2);
+    }
+
+private:
+    const int capacity;
+    Count* vals;
+    Links* links;
+    /// @brief the first counter of a bucket, or the next free bucket.
+    Index* bucket_first;
+    Index free_bucket;
+
+    Index new_bucket(Index first) {
+        Index b = free_bucket;
+        free_bucket = bucket_first[b];
+        bucket_first[b] = first;
+        return b;
+    }
+    void free_bucket_of(Index b) {
+        bucket_first[b] = free_bucket;
+        free_bucket = b;
+    }
+
+    static Index checked(Index i, int n) {
+        if (i >= Index(n))
+            throw std::invalid_argument("Snapshot: link out of range");
+        return i;
+    }
+};
+
+#endif // _STREAMSUMMARY_H_
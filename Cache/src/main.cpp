@@ -1,7 +1,9 @@
 #include <cstring>
 #include <cstdlib>
 #include <cstdio>
+#include <ctime>
 #include <cassert>
+#include <iostream>
 #include <vector>
 #include <set>
 #include <list>
@@ -14,28 +16,22 @@ const double addpre = UNIT_TIME * 30;
 #include "../../CPU/ComparedAlgorithms/ClockSketch.h"
 #include "../../CPU/ComparedAlgorithms/groundtruth.h"
 #include "../../CPU/HyperCalm/HyperBloomFilter.h"
+#include "../../CPU/datasets/columnar_trace.h"
 #include "CalmSpaceSavingCache.h"
 #include "lfu.h"
 #include "lru.h"
 
 set<pair<float, uint32_t>> pref;
 vector<pair<uint32_t, float>> loaddata(char* filename) {
-	FILE* pf = fopen(filename, "rb");
-	if (!pf) {
-		printf("%s not found!\n", filename);
-		exit(-1);
-	}
-	double ftime = -1;
-	vector<pair<uint32_t, float>> vec;
-	uint32_t id;
-	while (fscanf(pf, "%d", &id) != EOF) {
-		uint32_t tkey = id;
-		double ttime;
-		fscanf(pf, "%lf", &ttime);
-		if (ftime < 0) ftime = ttime;
-		vec.push_back(pair<uint32_t, float>(tkey, ttime - ftime));
-	}
-	fclose(pf);
+	timespec load_start, load_end;
+	clock_gettime(CLOCK_MONOTONIC, &load_start);
+	// "key time" a line, parsed on all cores, or its columnar trace
+	vector<pair<uint32_t, float>> vec = columnar::is_columnar(filename)
+		? columnar::ColumnarTrace(filename).records()
+		: text_trace::parse_key_time(filename);
+	clock_gettime(CLOCK_MONOTONIC, &load_end);
+	printf("Startup Time:\t %.1f ms (loading %zu items)\n",
+		(load_end.tv_sec - load_start.tv_sec) * 1e3 + (load_end.tv_nsec - load_start.tv_nsec) / 1e6, vec.size());
 	return vec;
 }
 void check_css(char* filename, int sz, int cachesize) {